@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <glm.hpp>
+
+#include "RT/Camera/Camera.h"
+#include "RT/Material/Material.h"
+#include "RT/Primitives/BVH.h"
+#include "RT/Primitives/HitVector.h"
+#include "RT/Primitives/Sphere.h"
+#include "RT/Scene/Scenes.h"
+#include "RT/Engine/shade.h"
+
+#include "Utils/Random.h"
+#include "Utils/Sampler.h"
+#include "Utils/VecStuff.h"
+
+// Kernel microbenchmarks - every kernel runs over fixed inputs (same seeds every run), reports time per operation
+// and compares it with results saved by earlier run.
+
+struct Options
+{
+    std::string filter;
+    // measured time per benchmark, split into `samples` batches whose median is reported
+    float min_time_ms = 300.0f;
+    int samples = 7;
+    std::string output;
+    std::string baseline;
+    // slowdown against baseline (percent) reported as regression
+    float threshold = 10.0f;
+};
+
+void print_usage(const char* exe)
+{
+    std::cerr << "Usage: " << exe << " [--filter SUBSTRING] [--min-time MS] [--samples N] [--output FILE.json] [--baseline FILE.json] [--threshold PERCENT]\n";
+}
+
+std::optional<Options> parse_args(int argc, char* argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc)
+            return {};
+
+        const std::string value = argv[++i];
+        try
+        {
+            if (arg == "--filter") opt.filter = value;
+            else if (arg == "--min-time") opt.min_time_ms = std::stof(value);
+            else if (arg == "--samples") opt.samples = std::stoi(value);
+            else if (arg == "--output") opt.output = value;
+            else if (arg == "--baseline") opt.baseline = value;
+            else if (arg == "--threshold") opt.threshold = std::stof(value);
+            else return {};
+        }
+        catch (const std::exception&)
+        {
+            return {};
+        }
+    }
+
+    if (opt.min_time_ms <= 0.0f || opt.samples < 1 || opt.threshold < 0.0f)
+        return {};
+    return opt;
+}
+
+// Benchmark runs `count` operations and returns something derived from their results, so they cannot be optimized out
+using Kernel = std::function<float(uint64_t count)>;
+
+struct Benchmark
+{
+    std::string name;
+    Kernel run;
+};
+
+struct Result
+{
+    std::string name;
+    double ns_per_op;
+};
+
+volatile float sink;
+
+double measure(const Kernel& run, const Options& opt)
+{
+    using clock = std::chrono::steady_clock;
+    auto time_ns = [&](uint64_t count)
+    {
+        const auto start = clock::now();
+        sink = run(count);
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+    };
+
+    // grow batch until it is long enough for clock resolution, this also warms up caches
+    uint64_t count = 16;
+    double ns = time_ns(count);
+    while (ns < 2e6)
+    {
+        count *= 2;
+        ns = time_ns(count);
+    }
+
+    const double batch_ns = 1e6 * opt.min_time_ms / opt.samples;
+    count = std::max<uint64_t>(count, static_cast<uint64_t>(count * batch_ns / ns));
+
+    std::vector<double> per_op;
+    for (int s = 0; s < opt.samples; s++)
+        per_op.push_back(time_ns(count) / count);
+
+    std::nth_element(per_op.begin(), per_op.begin() + per_op.size() / 2, per_op.end());
+    return per_op[per_op.size() / 2];
+}
+
+// ==== fixed inputs ====
+
+constexpr size_t input_count = 1024;
+
+// inputs are drawn in separate statements, argument evaluation order would make them compiler dependent
+glm::vec3 random_vec(Utils::PCG32& random, float lo, float hi)
+{
+    glm::vec3 v;
+    v.x = random.uniform(lo, hi);
+    v.y = random.uniform(lo, hi);
+    v.z = random.uniform(lo, hi);
+    return v;
+}
+
+glm::vec3 random_dir(Utils::PCG32& random)
+{
+    glm::vec2 u;
+    u.x = random.uniform();
+    u.y = random.uniform();
+    return Utils::Vec3::sphere_uniform(u);
+}
+
+// rays from shell of `distance` around origin aimed at random points within `spread`
+std::vector<ray> make_rays(uint64_t seed, float distance, float spread)
+{
+    Utils::PCG32 random(seed);
+    std::vector<ray> rays;
+    rays.reserve(input_count);
+    for (size_t i = 0; i < input_count; i++)
+    {
+        const glm::vec3 origin = random_dir(random) * distance;
+        const glm::vec3 target = random_vec(random, -spread, spread);
+        rays.emplace_back(origin, glm::normalize(target - origin));
+    }
+    return rays;
+}
+
+std::vector<Benchmark> make_benchmarks()
+{
+    std::vector<Benchmark> benchmarks;
+
+    // ---- sphere ----
+    {
+        auto sphere = std::make_shared<Primitives::Sphere>(glm::vec3(0.0f), 1.0f, 0);
+        // aimed well inside / well outside of silhouette
+        auto hit = std::make_shared<std::vector<ray>>(make_rays(1, 10.0f, 0.5f));
+        auto miss = std::make_shared<std::vector<ray>>();
+        Utils::PCG32 random(2);
+        for (const ray& r : *hit)
+        {
+            const glm::vec3 side = glm::normalize(glm::cross(r.dir, random_dir(random)));
+            miss->emplace_back(r.origin, glm::normalize(-r.origin + side * 3.0f));
+        }
+
+        for (auto [name, rays] : { std::make_pair("sphere/hit", hit), std::make_pair("sphere/miss", miss) })
+        {
+            benchmarks.push_back({ name, [sphere, rays = rays](uint64_t count)
+                {
+                    float sum = 0.0f;
+                    for (uint64_t i = 0; i < count; i++)
+                    {
+                        if (const auto rec = sphere->intersect((*rays)[i % input_count], 0.001f, 1e30f))
+                            sum += rec->dis;
+                    }
+                    return sum;
+                } });
+        }
+    }
+
+    // ---- hit vector (linear scan) ----
+    for (int n : { 1, 4, 16, 64 })
+    {
+        auto objects = std::make_shared<Primitives::HitVector>();
+        Utils::PCG32 random(3 + n);
+        for (int i = 0; i < n; i++)
+        {
+            const glm::vec3 center = random_vec(random, -8.0f, 8.0f);
+            const float radius = random.uniform(0.5f, 1.5f);
+            objects->push_back(std::make_unique<Primitives::Sphere>(center, radius, 0));
+        }
+        auto rays = std::make_shared<std::vector<ray>>(make_rays(4, 30.0f, 8.0f));
+
+        benchmarks.push_back({ "hitvector/" + std::to_string(n), [objects, rays](uint64_t count)
+            {
+                float sum = 0.0f;
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    if (const auto rec = objects->intersect((*rays)[i % input_count], 0.001f, 1e30f))
+                        sum += rec->dis;
+                }
+                return sum;
+            } });
+    }
+
+    // ---- camera ----
+    {
+        auto camera = std::make_shared<Cam::Camera>(glm::vec3(-2.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 9.0f / 16.0f, 1.0f);
+        auto uv = std::make_shared<std::vector<glm::vec2>>();
+        Utils::PCG32 random(5);
+        for (size_t i = 0; i < input_count; i++)
+        {
+            const float u = random.uniform(-1.0f, 1.0f);
+            const float v = random.uniform(-1.0f, 1.0f);
+            uv->emplace_back(u, v);
+        }
+
+        benchmarks.push_back({ "camera/genray", [camera, uv](uint64_t count)
+            {
+                float sum = 0.0f;
+                for (uint64_t i = 0; i < count; i++)
+                    sum += camera->genray((*uv)[i % input_count]).dir.x;
+                return sum;
+            } });
+    }
+
+    // ---- sampling ----
+    benchmarks.push_back({ "warp/sphere_uniform", [](uint64_t count)
+        {
+            float sum = 0.0f;
+            for (uint64_t i = 0; i < count; i++)
+                sum += Utils::Vec3::sphere_uniform({ (i % 61) / 61.0f, (i % 67) / 67.0f }).x;
+            return sum;
+        } });
+
+    // one pixel sample - camera dimension and one bounce of scatter and roulette draws
+    for (Utils::SamplerType type : { Utils::SamplerType::Random, Utils::SamplerType::Sobol, Utils::SamplerType::BlueNoise })
+    {
+        benchmarks.push_back({ std::string("sampler/") + Utils::sampler_name(type), [type](uint64_t count)
+            {
+                float sum = 0.0f;
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    Utils::Sampler sampler(type, 6, static_cast<uint32_t>(i % 64), static_cast<uint32_t>(i / 64 % 64), static_cast<uint32_t>(i / 4096));
+                    sum += sampler.get2d().x;
+                    sampler.start_bounce(0);
+                    sum += sampler.get2d().y;
+                    sum += sampler.get1d();
+                    sampler.start_bounce(0, Utils::Sampler::roulette_dimension);
+                    sum += sampler.get1d();
+                }
+                return sum;
+            } });
+    }
+
+    // ---- materials ----
+    {
+        // rays hitting plane z = 0 from above, glass is entered and left alternately
+        auto hits = std::make_shared<std::vector<std::pair<ray, Primitives::Record>>>();
+        Utils::PCG32 random(7);
+        for (size_t i = 0; i < input_count; i++)
+        {
+            glm::vec3 dir = random_dir(random);
+            dir.z = -std::abs(dir.z) - 0.05f;
+            const ray r(glm::vec3(0.0f, 0.0f, 1.0f), glm::normalize(dir));
+            const glm::vec3 normal(0.0f, 0.0f, i % 2 ? 1.0f : -1.0f);
+            hits->emplace_back(ray(r.origin, r.dir), Primitives::Record::from(r.at(1.0f / -r.dir.z), normal, 1.0f / -r.dir.z, r, 0));
+        }
+
+        const std::pair<const char*, Mat::Material> materials[] = {
+            { "scatter/diffuse", Mat::Material::diffuse({ 0.5f, 0.5f, 0.5f }) },
+            { "scatter/metalic", Mat::Material::metalic({ 0.8f, 0.8f, 0.8f }, 0.3f) },
+            { "scatter/refract", Mat::Material::refract(1.5f) },
+        };
+        for (const auto& [name, material] : materials)
+        {
+            benchmarks.push_back({ name, [hits, material = material](uint64_t count)
+                {
+                    float sum = 0.0f;
+                    glm::vec3 att;
+                    ray out({}, {});
+                    for (uint64_t i = 0; i < count; i++)
+                    {
+                        const auto& [in, rec] = (*hits)[i % input_count];
+                        Utils::Sampler sampler(Utils::SamplerType::Sobol, 8, 0, 0, static_cast<uint32_t>(i));
+                        sampler.start_bounce(0);
+                        if (material.scatter(in, rec, att, out, sampler))
+                            sum += out.dir.x + att.x;
+                    }
+                    return sum;
+                } });
+        }
+    }
+
+    // ---- whole path ----
+    for (const char* scene : { "demo", "spheres", "room" })
+    {
+        struct Setup
+        {
+            Scenes::SceneDesc desc;
+            std::unique_ptr<Primitives::BVH> world;
+            Cam::Camera camera;
+        };
+
+        auto desc = Scenes::make(scene);
+        const Cam::Camera camera = desc->camera(9.0f / 16.0f);
+        auto setup = std::make_shared<Setup>(Setup{ std::move(*desc), nullptr, camera });
+        setup->world = std::make_unique<Primitives::BVH>(std::move(setup->desc.world));
+
+        benchmarks.push_back({ std::string("gen_color/") + scene, [setup](uint64_t count)
+            {
+                // 64 x 36 pixel grid, every pass over it takes next sample of every pixel
+                constexpr uint32_t w = 64, h = 36;
+                const PathSettings settings;
+                size_t rays = 0;
+                float sum = 0.0f;
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    const uint32_t pixel = static_cast<uint32_t>(i % (w * h));
+                    Utils::Sampler sampler(Utils::SamplerType::Sobol, 9, pixel % w, pixel / w, static_cast<uint32_t>(i / (w * h)));
+                    const glm::vec2 jitter = sampler.get2d();
+                    const float u = ((pixel / w + jitter.y) / (h - 1) - 0.5f) * 2.0f;
+                    const float v = ((pixel % w + jitter.x) / (w - 1) - 0.5f) * 2.0f;
+                    sum += gen_color(setup->camera.genray({ u, v }), *setup->world, setup->desc.materials, setup->desc.lights, sampler, settings, rays).x;
+                }
+                return sum;
+            } });
+    }
+
+    return benchmarks;
+}
+
+// ==== results ====
+
+std::string make_json(const std::vector<Result>& results)
+{
+    // one benchmark per line, `load_baseline` relies on it
+    std::ostringstream out;
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        out << "    { \"name\": \"" << results[i].name << "\", \"ns_per_op\": " << results[i].ns_per_op
+            << ", \"ops_per_second\": " << 1e9 / results[i].ns_per_op << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return out.str();
+}
+
+std::optional<std::map<std::string, double>> load_baseline(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+        return std::nullopt;
+
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const std::string name_key = "\"name\": \"";
+        const std::string time_key = "\"ns_per_op\": ";
+        const size_t name = line.find(name_key);
+        const size_t time = line.find(time_key);
+        if (name == std::string::npos || time == std::string::npos)
+            continue;
+
+        const size_t begin = name + name_key.size();
+        const size_t end = line.find('"', begin);
+        try
+        {
+            baseline[line.substr(begin, end - begin)] = std::stod(line.substr(time + time_key.size()));
+        }
+        catch (const std::exception&)
+        {
+            return std::nullopt;
+        }
+    }
+    return baseline;
+}
+
+int main(int argc, char* argv[])
+{
+    const auto opt = parse_args(argc, argv);
+    if (!opt.has_value())
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!opt->baseline.empty())
+    {
+        auto loaded = load_baseline(opt->baseline);
+        if (!loaded.has_value())
+        {
+            std::cerr << "[ERROR]: Cannot read baseline " << opt->baseline << std::endl;
+            return -1;
+        }
+        baseline = std::move(*loaded);
+    }
+
+    std::cout << std::left << std::setw(26) << "benchmark" << std::right << std::setw(12) << "ns/op" << std::setw(14) << "Mops/s";
+    if (!baseline.empty())
+        std::cout << std::setw(12) << "baseline" << std::setw(10) << "change";
+    std::cout << "\n";
+
+    std::vector<Result> results;
+    int regressions = 0;
+    for (const Benchmark& benchmark : make_benchmarks())
+    {
+        if (benchmark.name.find(opt->filter) == std::string::npos)
+            continue;
+
+        const double ns = measure(benchmark.run, *opt);
+        results.push_back({ benchmark.name, ns });
+
+        std::cout << std::left << std::setw(26) << benchmark.name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(12) << ns << std::setw(14) << 1e3 / ns;
+
+        const auto base = baseline.find(benchmark.name);
+        if (base != baseline.end())
+        {
+            const double change = 100.0 * (ns / base->second - 1.0);
+            const bool slower = change > opt->threshold;
+            regressions += slower ? 1 : 0;
+            std::cout << std::setw(12) << base->second << std::setw(9) << std::showpos << change << "%" << std::noshowpos << (slower ? "  SLOWER" : "");
+        }
+        std::cout << std::endl;
+    }
+
+    if (!opt->output.empty())
+    {
+        std::ofstream file(opt->output);
+        file << make_json(results);
+        if (!file)
+        {
+            std::cerr << "[ERROR]: Cannot write results to " << opt->output << std::endl;
+            return -1;
+        }
+    }
+
+    if (regressions > 0)
+    {
+        std::cerr << regressions << " benchmark(s) slower than baseline by more than " << opt->threshold << "%" << std::endl;
+        return 1;
+    }
+    return 0;
+}
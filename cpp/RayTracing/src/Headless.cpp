@@ -0,0 +1,440 @@
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <glm.hpp>
+
+#include "RT/Primitives/BVH.h"
+#include "RT/Primitives/Sphere.h"
+#include "RT/Primitives/SphereSet.h"
+#include "RT/Primitives/StaticScene.h"
+#include "RT/Primitives/TriangleMesh.h"
+#include "RT/Scene/Scenes.h"
+#include "RT/Scene/SceneCache.h"
+
+#include "RT/Engine/RenderTarget.h"
+#include "RT/Engine/RTRenderer.h"
+#include "RT/Engine/Denoise.h"
+#include "RT/Engine/AOV.h"
+
+#include "Utils/ImageWriter.h"
+#include "Utils/Trace.h"
+
+// Offline renderer - traces scene without window and reports throughput as JSON.
+
+struct Options
+{
+    std::string scene = "demo";
+    std::string mesh;
+    std::string write_cache;
+    std::string accel = "bvh";
+    size_t width = 1280;
+    size_t height = 720;
+    int spp = 32;
+    int bounces = 5;
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    uint64_t seed = 0;
+    int tile = 16;
+    bool packets = true;
+    bool roulette = true;
+    bool wavefront = false;
+    bool next_event = true;
+    Utils::SamplerType sampler = Utils::SamplerType::Sobol;
+    float noise_target = 0.0f;
+    bool denoise = false;
+    std::string output = "render.ppm";
+    std::string aov;
+    uint32_t aovs = RT::all_aovs;
+    std::string report;
+    std::string stats;
+    std::string trace;
+};
+
+void print_usage(const char* exe)
+{
+    std::cerr << "Usage: " << exe << " [--scene NAME|FILE.rtscene] [--mesh FILE.obj|FILE.ply] [--write-cache FILE.rtscene] [--accel bvh|static] [--width W] [--height H] [--spp N] [--bounces N] [--threads N] [--seed N] [--tile N] [--packets 0|1] [--roulette 0|1] [--wavefront 0|1] [--nee 0|1] [--sampler random|sobol|bluenoise] [--noise-target E] [--denoise 0|1] [--output FILE.ppm] [--aov FILE.exr|FILE.pfm] [--aov-channels beauty,albedo,normal,depth,samples,variance] [--report FILE.json] [--stats FILE.json] [--trace FILE.json]\n";
+    std::cerr << "  --noise-target E  pixels stop sampling once standard error of mean luminance / sqrt(mean luminance) < E\n";
+    std::cerr << "Scenes:";
+    for (const auto& name : Scenes::names())
+        std::cerr << " " << name;
+    std::cerr << std::endl;
+}
+
+std::optional<Options> parse_args(int argc, char* argv[])
+{
+    Options opt;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc)
+            return {};
+
+        const std::string value = argv[++i];
+        try
+        {
+            if (arg == "--scene") opt.scene = value;
+            else if (arg == "--mesh") opt.mesh = value;
+            else if (arg == "--write-cache") opt.write_cache = value;
+            else if (arg == "--accel") opt.accel = value;
+            else if (arg == "--width") opt.width = std::stoul(value);
+            else if (arg == "--height") opt.height = std::stoul(value);
+            else if (arg == "--spp") opt.spp = std::stoi(value);
+            else if (arg == "--bounces") opt.bounces = std::stoi(value);
+            else if (arg == "--threads") opt.threads = std::stoi(value);
+            else if (arg == "--seed") opt.seed = std::stoull(value);
+            else if (arg == "--tile") opt.tile = std::stoi(value);
+            else if (arg == "--packets") opt.packets = std::stoi(value) != 0;
+            else if (arg == "--roulette") opt.roulette = std::stoi(value) != 0;
+            else if (arg == "--wavefront") opt.wavefront = std::stoi(value) != 0;
+            else if (arg == "--nee") opt.next_event = std::stoi(value) != 0;
+            else if (arg == "--sampler")
+            {
+                const auto sampler = Utils::parse_sampler(value);
+                if (!sampler.has_value())
+                    return {};
+                opt.sampler = *sampler;
+            }
+            else if (arg == "--noise-target") opt.noise_target = std::stof(value);
+            else if (arg == "--denoise") opt.denoise = std::stoi(value) != 0;
+            else if (arg == "--output") opt.output = value;
+            else if (arg == "--aov") opt.aov = value;
+            else if (arg == "--aov-channels")
+            {
+                std::string error;
+                const auto aovs = RT::parse_aovs(value, error);
+                if (!aovs.has_value())
+                {
+                    std::cerr << "[ERROR]: " << error << std::endl;
+                    return {};
+                }
+                opt.aovs = *aovs;
+            }
+            else if (arg == "--report") opt.report = value;
+            else if (arg == "--stats") opt.stats = value;
+            else if (arg == "--trace") opt.trace = value;
+            else return {};
+        }
+        catch (const std::exception&)
+        {
+            return {};
+        }
+    }
+
+    if (opt.accel != "bvh" && opt.accel != "static")
+        return {};
+    if (!opt.aov.empty() && !RT::image_format(opt.aov).has_value())
+        return {};
+    if (opt.width < 2 || opt.height < 2 || opt.spp < 1 || opt.bounces < 1 || opt.threads < 1 || opt.tile < 1 || opt.noise_target < 0.0f)
+        return {};
+    return opt;
+}
+
+void write_stats(std::ostream& out, const RT::IterationStats& stats, const std::string& indent)
+{
+    const Utils::Counters& c = stats.counters;
+    out << indent << "\"level\": " << stats.level << ",\n";
+    out << indent << "\"workers\": " << stats.workers << ",\n";
+    out << indent << "\"tiles\": " << stats.tiles << ",\n";
+    out << indent << "\"steals\": " << stats.steals << ",\n";
+    out << indent << "\"wall_ms\": " << stats.wall_ms << ",\n";
+    out << indent << "\"busy_ms\": " << stats.busy_ms << ",\n";
+    out << indent << "\"schedule_ms\": " << stats.schedule_ms << ",\n";
+    out << indent << "\"idle_ms\": " << stats.idle_ms << ",\n";
+    out << indent << "\"lock_wait_ms\": " << stats.lock_wait_ms << ",\n";
+    out << indent << "\"publish_ms\": " << stats.publish_ms << ",\n";
+    out << indent << "\"busy_ratio\": " << stats.busy_ratio() << ",\n";
+    out << indent << "\"primary_rays\": " << c.primary_rays << ",\n";
+    out << indent << "\"secondary_rays\": " << c.secondary_rays << ",\n";
+    out << indent << "\"shadow_rays\": " << c.shadow_rays << ",\n";
+    out << indent << "\"box_tests\": " << c.box_tests << ",\n";
+    out << indent << "\"primitive_tests\": " << c.primitive_tests << ",\n";
+    out << indent << "\"paths\": " << c.paths << ",\n";
+    out << indent << "\"escaped_ratio\": " << stats.escaped_ratio() << ",\n";
+    out << indent << "\"depth_histogram\": [";
+    for (int i = 0; i < Utils::Counters::depth_bins; i++)
+        out << (i == 0 ? "" : ", ") << c.depth[i];
+    out << "]\n";
+}
+
+std::string make_stats(const RT::RenderStats& stats)
+{
+    std::ostringstream out;
+    out << "{\n  \"total\": {\n";
+    write_stats(out, stats.total(), "    ");
+    out << "  },\n  \"iterations\": [";
+    for (size_t i = 0; i < stats.iterations.size(); i++)
+    {
+        out << (i == 0 ? "\n" : ",\n") << "    {\n";
+        write_stats(out, stats.iterations[i], "      ");
+        out << "    }";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+// quoted JSON string, escapes quotes, backslashes of Windows paths and control characters
+std::string json_string(const std::string& text)
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string out = "\"";
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 0xF];
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+std::string make_report(const Options& opt, RT::RTRenderer& renderer, const RT::Frame& frame, double denoise_ms)
+{
+    const double seconds = renderer.get_total_render_time().count() / 1000.0;
+    const double rays = static_cast<double>(renderer.get_traced_rays());
+
+    double samples = 0.0;
+    for (uint32_t count : frame.counts)
+        samples += count;
+
+    std::ostringstream out;
+    out << "{\n";
+    out << "  \"scene\": " << json_string(opt.scene) << ",\n";
+    out << "  \"accel\": \"" << opt.accel << "\",\n";
+    out << "  \"width\": " << opt.width << ",\n";
+    out << "  \"height\": " << opt.height << ",\n";
+    out << "  \"spp\": " << renderer.iterations() << ",\n";
+    out << "  \"bounces\": " << opt.bounces << ",\n";
+    out << "  \"threads\": " << opt.threads << ",\n";
+    out << "  \"seed\": " << opt.seed << ",\n";
+    out << "  \"packets\": " << (opt.packets ? "true" : "false") << ",\n";
+    out << "  \"roulette\": " << (opt.roulette ? "true" : "false") << ",\n";
+    out << "  \"wavefront\": " << (opt.wavefront ? "true" : "false") << ",\n";
+    out << "  \"next_event\": " << (opt.next_event ? "true" : "false") << ",\n";
+    out << "  \"sampler\": \"" << Utils::sampler_name(opt.sampler) << "\",\n";
+    out << "  \"wall_time_s\": " << seconds << ",\n";
+    out << "  \"rays\": " << renderer.get_traced_rays() << ",\n";
+    out << "  \"rays_per_second\": " << (seconds > 0.0 ? rays / seconds : 0.0) << ",\n";
+    out << "  \"samples_per_second\": " << (seconds > 0.0 ? samples / seconds : 0.0) << ",\n";
+    out << "  \"noise_target\": " << opt.noise_target << ",\n";
+    out << "  \"mean_spp\": " << samples / frame.counts.size() << ",\n";
+    out << "  \"active_pixels\": " << renderer.get_active_pixels() << ",\n";
+    out << "  \"denoise\": " << (opt.denoise ? "true" : "false") << ",\n";
+    out << "  \"denoise_ms\": " << denoise_ms << ",\n";
+    out << "  \"stats\": {\n";
+    write_stats(out, renderer.get_stats().total(), "    ");
+    out << "  },\n";
+    out << "  \"iteration_ms\": [";
+
+    const auto& times = renderer.get_iteration_times();
+    for (size_t i = 0; i < times.size(); i++)
+        out << (i == 0 ? "" : ", ") << times[i].count();
+    out << "],\n";
+
+    const auto tiles = renderer.get_tile_costs();
+    float tile_total = 0.0f, tile_max = 0.0f;
+    for (const auto& t : tiles)
+    {
+        tile_total += t.ms;
+        tile_max = std::max(tile_max, t.ms);
+    }
+    out << "  \"tile_size\": " << opt.tile << ",\n";
+    out << "  \"tiles\": " << tiles.size() << ",\n";
+    out << "  \"tile_ms_mean\": " << (tiles.empty() ? 0.0f : tile_total / tiles.size()) << ",\n";
+    out << "  \"tile_ms_max\": " << tile_max << "\n";
+    out << "}\n";
+
+    return out.str();
+}
+
+int main(int argc, char* argv[])
+{
+    RT_TRACE_THREAD("main");
+    const auto opt = parse_args(argc, argv);
+    if (!opt.has_value())
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    const auto load_start = std::chrono::steady_clock::now();
+    std::optional<Scenes::SceneDesc> desc;
+    if (Scenes::is_cache_path(opt->scene))
+    {
+        std::string error;
+        desc = Scenes::load_cache(opt->scene, error);
+        if (!desc.has_value())
+        {
+            std::cerr << "[ERROR]: " << error << std::endl;
+            return -1;
+        }
+    }
+    else
+    {
+        desc = Scenes::make(opt->scene);
+        if (!desc.has_value())
+        {
+            std::cerr << "[ERROR]: Unknown scene '" << opt->scene << "'" << std::endl;
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (!opt->mesh.empty())
+    {
+        std::string error;
+        if (!Scenes::add_mesh(*desc, opt->mesh, error))
+        {
+            std::cerr << "[ERROR]: " << error << std::endl;
+            return -1;
+        }
+    }
+
+    const std::chrono::duration<double, std::milli> load_time = std::chrono::steady_clock::now() - load_start;
+    std::cerr << "Scene ready in " << load_time.count() << " ms" << std::endl;
+
+    if (!opt->write_cache.empty())
+    {
+        std::string error;
+        if (!Scenes::save_cache(*desc, opt->write_cache, error))
+        {
+            std::cerr << "[ERROR]: " << error << std::endl;
+            return -1;
+        }
+    }
+
+    const float aspectratio = static_cast<float>(opt->height) / opt->width;
+    const Cam::Camera camera = desc->camera(aspectratio);
+
+    // static scene devirtualizes intersection, but tests every object - meant for small scenes
+    using StaticWorld = Primitives::StaticScene<Primitives::Sphere, Primitives::SphereSet, Primitives::TriangleMesh>;
+    std::unique_ptr<Primitives::IHittable> world;
+    if (opt->accel == "static")
+    {
+        auto scene = StaticWorld::from(desc->world);
+        if (!scene.has_value())
+        {
+            std::cerr << "[ERROR]: Scene '" << opt->scene << "' has primitives not supported by static scene" << std::endl;
+            return -1;
+        }
+        world = std::make_unique<StaticWorld>(std::move(*scene));
+    }
+    else
+    {
+        world = std::make_unique<Primitives::BVH>(std::move(desc->world));
+    }
+
+    RT::RenderTarget target(opt->width, opt->height);
+    RT::RTRenderer renderer(target, opt->spp, opt->bounces, opt->threads, opt->seed);
+
+    renderer.request_tile_size(opt->tile);
+    renderer.request_packet_tracing(opt->packets);
+    renderer.request_russian_roulette(opt->roulette);
+    renderer.request_wavefront(opt->wavefront);
+    renderer.request_sampler(opt->sampler);
+    renderer.request_next_event(opt->next_event);
+    renderer.request_noise_target(opt->noise_target);
+    renderer.request_world_update(*world, desc->materials, desc->lights);
+    renderer.request_camera_update(camera);
+
+    while (!renderer.is_done())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    renderer.kill_render_thread();
+
+    const RT::Frame* frame = target.acquire();
+    if (frame == nullptr)
+    {
+        std::cerr << "[ERROR]: Nothing was rendered" << std::endl;
+        return -1;
+    }
+
+    // AOVs come from raw samples, written in background while the rest of output is produced
+    RT::AOVWriter aov_writer;
+    if (!opt->aov.empty())
+    {
+        thread_pool pool(opt->threads);
+        RT::AOVBuffer aovs(opt->aovs, opt->width, opt->height);
+        aovs.capture(*frame, pool);
+        aov_writer.submit(std::move(aovs), opt->aov, *RT::image_format(opt->aov));
+    }
+
+    // filtered frame only replaces the written image, report is about the samples
+    RT::Frame denoised;
+    double denoise_ms = 0.0;
+    if (opt->denoise)
+    {
+        thread_pool pool(opt->threads);
+        RT::Denoiser denoiser;
+        const auto start = std::chrono::steady_clock::now();
+        denoiser.denoise(*frame, denoised, pool);
+        denoise_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    const RT::Frame& result = opt->denoise ? denoised : *frame;
+
+    std::vector<glm::vec3> image(opt->width * opt->height);
+    for (size_t y = 0; y < opt->height; y++)
+        for (size_t x = 0; x < opt->width; x++)
+            image[x + y * opt->width] = result.mean(x, y);
+
+    if (!Utils::Image::write_ppm(opt->output, image, opt->width, opt->height))
+    {
+        std::cerr << "[ERROR]: Cannot write image to " << opt->output << std::endl;
+        return -1;
+    }
+
+    if (!aov_writer.flush())
+        return -1;
+
+    if (!opt->trace.empty())
+    {
+        if (!Utils::Trace::enabled)
+            std::cerr << "[WARNING]: Built without RT_TRACING, trace is empty" << std::endl;
+        if (!Utils::Trace::write_json(opt->trace))
+        {
+            std::cerr << "[ERROR]: Cannot write trace to " << opt->trace << std::endl;
+            return -1;
+        }
+    }
+
+    if (!opt->stats.empty())
+    {
+        std::ofstream file(opt->stats);
+        file << make_stats(renderer.get_stats());
+        if (!file)
+        {
+            std::cerr << "[ERROR]: Cannot write statistics to " << opt->stats << std::endl;
+            return -1;
+        }
+    }
+
+    const std::string report = make_report(*opt, renderer, *frame, denoise_ms);
+    if (opt->report.empty())
+    {
+        std::cout << report;
+    }
+    else
+    {
+        std::ofstream file(opt->report);
+        file << report;
+        if (!file)
+        {
+            std::cerr << "[ERROR]: Cannot write report to " << opt->report << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
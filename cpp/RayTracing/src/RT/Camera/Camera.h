@@ -1,6 +1,7 @@
 #pragma once
 #include <glm.hpp>
 #include <iostream>
+#include <optional>
 #include <gtc/matrix_transform.hpp>
 #include "Ray.h"
 
@@ -10,13 +11,15 @@ namespace Cam
 	{
 	public:
 		glm::mat4 inverse;
+		glm::mat4 view_proj;
 		glm::vec3 origin;
 		Camera(const glm::vec3& pos, const glm::vec3& camera_dir, float aspectratio, float focal, float near = 0.2, float far = 1.0)
 		{
 			glm::mat4 proj = glm::perspective(focal, aspectratio, near, far);
 			glm::mat4 view = glm::lookAt(glm::vec3(0.0f), camera_dir, { 0.0f, 1.0f, 0.0f });
 
-			inverse = glm::inverse(proj * view);
+			view_proj = proj * view;
+			inverse = glm::inverse(view_proj);
 			origin = pos;
 		}
 
@@ -32,6 +35,17 @@ namespace Cam
 			glm::vec3 orig = origin;
 			return ray(orig, dir);
 		}
+
+		/// <summary>
+		/// Inverse of `genray` - screen coordinates of direction `dir` (relative to camera origin), nullopt if it points behind camera.
+		/// </summary>
+		std::optional<glm::vec2> project(const glm::vec3& dir) const
+		{
+			const glm::vec4 clip = view_proj * glm::vec4(dir, 1.0f);
+			if (clip.w <= 0.0f)
+				return std::nullopt;
+			return glm::vec2(clip) / clip.w;
+		}
 	};
 }
 
@@ -0,0 +1,41 @@
+#pragma once
+#include <glm.hpp>
+#include "Ray.h"
+#include "../../Utils/Simd.h"
+
+/// <summary>
+/// Four rays in SoA layout. `active` has bit `i` set if lane `i` carries valid ray.
+/// </summary>
+struct RayPacket
+{
+	static constexpr int width = 4;
+
+	Utils::float4 ox, oy, oz;
+	Utils::float4 dx, dy, dz;
+	int active = 0;
+
+	RayPacket(const ray* rays, int active) : active(active)
+	{
+		alignas(16) float o[3][width];
+		alignas(16) float d[3][width];
+		for (int lane = 0; lane < width; lane++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				o[c][lane] = rays[lane].origin[c];
+				d[c][lane] = rays[lane].dir[c];
+			}
+		}
+		ox = Utils::float4::load(o[0]); oy = Utils::float4::load(o[1]); oz = Utils::float4::load(o[2]);
+		dx = Utils::float4::load(d[0]); dy = Utils::float4::load(d[1]); dz = Utils::float4::load(d[2]);
+	}
+
+	ray get(int lane) const
+	{
+		alignas(16) float o[3][width];
+		alignas(16) float d[3][width];
+		ox.store(o[0]); oy.store(o[1]); oz.store(o[2]);
+		dx.store(d[0]); dy.store(d[1]); dz.store(d[2]);
+		return ray({ o[0][lane], o[1][lane], o[2][lane] }, { d[0][lane], d[1][lane], d[2][lane] });
+	}
+};
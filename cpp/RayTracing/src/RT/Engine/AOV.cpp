@@ -0,0 +1,290 @@
+#include "AOV.h"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <iostream>
+#include <sstream>
+#include "../../Utils/Trace.h"
+
+namespace
+{
+    constexpr const char* names[] = { "beauty", "albedo", "normal", "depth", "samples", "variance" };
+    constexpr uint32_t component_counts[] = { 3, 3, 3, 1, 1, 1 };
+
+    static_assert(std::size(names) == static_cast<size_t>(RT::AOV::Count), "Every AOV needs a name.");
+
+    bool ends_with(const std::string& s, const std::string& suffix)
+    {
+        return s.size() >= suffix.size() && std::equal(suffix.rbegin(), suffix.rend(), s.rbegin(), [](char a, char b)
+            {
+                return std::tolower(static_cast<unsigned char>(a)) == b;
+            });
+    }
+
+    size_t round_up(size_t value, size_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+}
+
+std::optional<RT::ImageFormat> RT::image_format(const std::string& path)
+{
+    if (ends_with(path, ".pfm"))
+        return ImageFormat::PFM;
+    if (ends_with(path, ".exr"))
+        return ImageFormat::EXR;
+    return std::nullopt;
+}
+
+std::optional<uint32_t> RT::parse_aovs(const std::string& list, std::string& error)
+{
+    uint32_t mask = 0;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        if (item == "all")
+        {
+            mask |= all_aovs;
+            continue;
+        }
+
+        const auto found = std::find(std::begin(names), std::end(names), item);
+        if (found == std::end(names))
+        {
+            error = "Unknown AOV '" + item + "'";
+            return std::nullopt;
+        }
+        mask |= aov_bit(static_cast<AOV>(found - std::begin(names)));
+    }
+
+    if (mask == 0)
+    {
+        error = "No AOV selected";
+        return std::nullopt;
+    }
+    return mask;
+}
+
+const char* RT::AOVBuffer::name(AOV aov)
+{
+    return names[static_cast<uint32_t>(aov)];
+}
+
+uint32_t RT::AOVBuffer::components(AOV aov)
+{
+    return component_counts[static_cast<uint32_t>(aov)];
+}
+
+RT::AOVBuffer::AOVBuffer(uint32_t aovs, size_t img_w, size_t img_h) :
+    mask(aovs & all_aovs),
+    img_w(img_w),
+    img_h(img_h),
+    stride(round_up(img_w, Frame::block_size)),
+    rows(round_up(img_h, Frame::block_size))
+{
+    size_t planes = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(AOV::Count); i++)
+    {
+        const AOV aov = static_cast<AOV>(i);
+        if (!has(aov))
+            continue;
+        channels.push_back({ aov, components(aov), planes });
+        planes += components(aov);
+    }
+    storage.assign(planes * stride * rows, 0.0f);
+}
+
+const RT::AOVBuffer::Channel* RT::AOVBuffer::find(AOV aov) const
+{
+    for (const Channel& channel : channels)
+    {
+        if (channel.aov == aov)
+            return &channel;
+    }
+    return nullptr;
+}
+
+const float* RT::AOVBuffer::plane(AOV aov, uint32_t c) const
+{
+    const Channel* channel = find(aov);
+    if (channel == nullptr || c >= channel->components)
+        return nullptr;
+    return storage.data() + (channel->offset + c) * stride * rows;
+}
+
+float* RT::AOVBuffer::plane(AOV aov, uint32_t c)
+{
+    return const_cast<float*>(static_cast<const AOVBuffer&>(*this).plane(aov, c));
+}
+
+void RT::AOVBuffer::capture(const Frame& frame, thread_pool& pool)
+{
+    float* beauty[3] = { plane(AOV::Beauty, 0), plane(AOV::Beauty, 1), plane(AOV::Beauty, 2) };
+    float* albedo[3] = { plane(AOV::Albedo, 0), plane(AOV::Albedo, 1), plane(AOV::Albedo, 2) };
+    float* normal[3] = { plane(AOV::Normal, 0), plane(AOV::Normal, 1), plane(AOV::Normal, 2) };
+    float* depth = plane(AOV::Depth, 0);
+    float* samples = plane(AOV::Samples, 0);
+    float* variance = plane(AOV::Variance, 0);
+    const bool guides = albedo[0] || normal[0] || depth;
+
+    pool.parallelize_loop(size_t(0), frame.blocks_y(), [&](size_t begin, size_t end)
+        {
+            RT_TRACE_SCOPE("aov capture");
+            const size_t y1 = std::min(img_h, end * Frame::block_size);
+            for (size_t y = begin * Frame::block_size; y < y1; y++)
+            {
+                for (size_t x = 0; x < img_w; x++)
+                {
+                    const size_t i = x + y * stride;
+                    const uint32_t n = frame.get_count(x, y);
+                    const glm::vec3 mean = frame.mean(x, y);
+
+                    if (beauty[0])
+                    {
+                        for (int c = 0; c < 3; c++)
+                            beauty[c][i] = mean[c];
+                    }
+                    if (guides)
+                    {
+                        const Guide g = frame.mean_guide(x, y);
+                        const float length = glm::length(g.normal);
+                        const glm::vec3 unit = length > 0.0f ? g.normal / length : glm::vec3(0.0f);
+                        for (int c = 0; c < 3; c++)
+                        {
+                            if (albedo[0])
+                                albedo[c][i] = g.albedo[c];
+                            if (normal[0])
+                                normal[c][i] = unit[c];
+                        }
+                        if (depth)
+                            depth[i] = g.depth;
+                    }
+                    if (samples)
+                        samples[i] = static_cast<float>(n);
+                    if (variance)
+                    {
+                        const float l = Frame::luminance(mean);
+                        const size_t p = x + y * frame.w();
+                        variance[i] = n == 0 ? 0.0f : std::max(0.0f, frame.raw_sq[p] / n - l * l) / n;
+                    }
+                }
+            }
+        });
+}
+
+std::vector<Utils::Image::Plane> RT::AOVBuffer::planes(AOV aov) const
+{
+    static constexpr const char* rgb[] = { "R", "G", "B" };
+    static constexpr const char* xyz[] = { "X", "Y", "Z" };
+
+    std::vector<Utils::Image::Plane> result;
+    const Channel* channel = find(aov);
+    if (channel == nullptr)
+        return result;
+
+    for (uint32_t c = 0; c < channel->components; c++)
+    {
+        std::string suffix;
+        switch (aov)
+        {
+        case AOV::Beauty:
+        case AOV::Albedo:
+            suffix = rgb[c];
+            break;
+        case AOV::Normal:
+            suffix = xyz[c];
+            break;
+        case AOV::Depth:
+            suffix = "Z";
+            break;
+        default:
+            suffix = "Y";
+            break;
+        }
+        result.push_back({ aov == AOV::Beauty ? suffix : std::string(name(aov)) + "." + suffix, plane(aov, c), stride });
+    }
+    return result;
+}
+
+bool RT::AOVWriter::write(const AOVBuffer& buffer, const std::string& path, ImageFormat format)
+{
+    if (format == ImageFormat::EXR)
+    {
+        std::vector<Utils::Image::Plane> planes;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(AOV::Count); i++)
+        {
+            const auto aov_planes = buffer.planes(static_cast<AOV>(i));
+            planes.insert(planes.end(), aov_planes.begin(), aov_planes.end());
+        }
+        return Utils::Image::write_exr(path, std::move(planes), buffer.w(), buffer.h());
+    }
+
+    const std::string stem = ends_with(path, ".pfm") ? path.substr(0, path.size() - 4) : path;
+    bool ok = true;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(AOV::Count); i++)
+    {
+        const AOV aov = static_cast<AOV>(i);
+        if (!buffer.has(aov))
+            continue;
+
+        const auto planes = buffer.planes(aov);
+        const std::string file = aov == AOV::Beauty ? path : stem + "." + AOVBuffer::name(aov) + ".pfm";
+        ok &= Utils::Image::write_pfm(file, planes.data(), planes.size(), buffer.w(), buffer.h());
+    }
+    return ok;
+}
+
+void RT::AOVWriter::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        wake.wait(guard, [&] { return stopping || !queue.empty(); });
+        if (queue.empty())
+            return;
+
+        Job job = std::move(queue.front());
+        queue.pop_front();
+        busy = true;
+
+        guard.unlock();
+        RT_TRACE_SCOPE("aov write");
+        const bool ok = write(job.buffer, job.path, job.format);
+        if (!ok)
+            std::cerr << "[ERROR]: Cannot write AOVs to " << job.path << std::endl;
+        guard.lock();
+
+        failures += ok ? 0 : 1;
+        busy = false;
+        idle.notify_all();
+    }
+}
+
+void RT::AOVWriter::submit(AOVBuffer buffer, std::string path, ImageFormat format)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queue.push_back({ std::move(buffer), std::move(path), format });
+    }
+    wake.notify_one();
+}
+
+bool RT::AOVWriter::flush()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [&] { return queue.empty() && !busy; });
+    const bool ok = failures == 0;
+    failures = 0;
+    return ok;
+}
+
+RT::AOVWriter::~AOVWriter()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../Utils/ImageWriter.h"
+#include "../../Utils/thread_pool.hpp"
+#include "RenderTarget.h"
+
+namespace RT
+{
+    /// <summary>
+    /// Arbitrary output variables, `AOVBuffer` holds any subset selected by mask of `aov_bit`s
+    /// </summary>
+    enum class AOV : uint32_t
+    {
+        // mean radiance
+        Beauty,
+        // guides of primary hit, averaged over samples (see `Guide`)
+        Albedo,
+        Normal,
+        Depth,
+        // number of samples taken by the pixel
+        Samples,
+        // variance of mean luminance, what is left of the noise
+        Variance,
+        Count,
+    };
+
+    constexpr uint32_t aov_bit(AOV aov)
+    {
+        return 1u << static_cast<uint32_t>(aov);
+    }
+
+    constexpr uint32_t all_aovs = (1u << static_cast<uint32_t>(AOV::Count)) - 1;
+
+    enum class ImageFormat
+    {
+        PFM,
+        EXR,
+    };
+
+    /// <summary>
+    /// Format by extension of `path` (.pfm or .exr)
+    /// </summary>
+    std::optional<ImageFormat> image_format(const std::string& path);
+
+    /// <summary>
+    /// Parses comma separated AOV names ("beauty,albedo,normal,depth,samples,variance" or "all") into mask
+    /// </summary>
+    std::optional<uint32_t> parse_aovs(const std::string& list, std::string& error);
+
+    /// <summary>
+    /// Planar float framebuffer with selected AOVs, every component has its own plane. Planes are padded
+    /// to whole `Frame::block_size` tiles, so blocks of a frame map to aligned rectangles of every plane.
+    /// </summary>
+    class AOVBuffer
+    {
+        struct Channel
+        {
+            AOV aov;
+            uint32_t components;
+            // offset of first plane in `storage`
+            size_t offset;
+        };
+
+        std::vector<Channel> channels;
+        std::vector<float> storage;
+        uint32_t mask = 0;
+        size_t img_w = 0, img_h = 0;
+        size_t stride = 0, rows = 0;
+
+        const Channel* find(AOV aov) const;
+
+    public:
+        AOVBuffer() = default;
+        AOVBuffer(uint32_t aovs, size_t img_w, size_t img_h);
+
+        size_t w() const { return img_w; }
+        size_t h() const { return img_h; }
+        uint32_t aovs() const { return mask; }
+        bool has(AOV aov) const { return (mask & aov_bit(aov)) != 0; }
+
+        /// <summary>
+        /// Component `c` of `aov`, rows are `pitch()` floats apart. nullptr if buffer does not hold `aov`.
+        /// </summary>
+        float* plane(AOV aov, uint32_t c);
+        const float* plane(AOV aov, uint32_t c) const;
+        size_t pitch() const { return stride; }
+
+        /// <summary>
+        /// Fills every held AOV from accumulated `frame` (same size as buffer), block rows are spread over `pool`
+        /// </summary>
+        void capture(const Frame& frame, thread_pool& pool);
+
+        /// <summary>
+        /// Named planes of `aov` for image writers, beauty is the default layer ("R", "G", "B")
+        /// and others are prefixed by their name ("albedo.R", "normal.X", "depth.Z", ...)
+        /// </summary>
+        std::vector<Utils::Image::Plane> planes(AOV aov) const;
+
+        static const char* name(AOV aov);
+        static uint32_t components(AOV aov);
+    };
+
+    /// <summary>
+    /// Writes AOV buffers on its own thread, so file I/O never blocks rendering or the window.
+    /// Buffers are moved in, caller only pays for `capture`. EXR puts all AOVs into one multi-layer file,
+    /// PFM writes beauty into `path` and each other AOV next to it as "name.aov.pfm".
+    /// </summary>
+    class AOVWriter
+    {
+        struct Job
+        {
+            AOVBuffer buffer;
+            std::string path;
+            ImageFormat format;
+        };
+
+        std::deque<Job> queue;
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        bool busy = false;
+        bool stopping = false;
+        size_t failures = 0;
+        std::thread worker;
+
+        void run();
+
+    public:
+        AOVWriter() : worker(&AOVWriter::run, this) {}
+        // finishes queued writes
+        ~AOVWriter();
+
+        AOVWriter(const AOVWriter&) = delete;
+        AOVWriter& operator=(const AOVWriter&) = delete;
+
+        /// <summary>
+        /// Queues `buffer` for writing and returns immediately
+        /// </summary>
+        void submit(AOVBuffer buffer, std::string path, ImageFormat format);
+
+        /// <summary>
+        /// Waits until queue is empty, returns false if any write since last flush failed
+        /// </summary>
+        bool flush();
+
+        /// <summary>
+        /// Writes `buffer` synchronously
+        /// </summary>
+        static bool write(const AOVBuffer& buffer, const std::string& path, ImageFormat format);
+    };
+}
@@ -0,0 +1,301 @@
+#include "Denoise.h"
+#include <cmath>
+#include <algorithm>
+#include "../../Utils/Trace.h"
+
+namespace
+{
+    // demodulation divides by albedo, floor keeps black surfaces from amplifying their noise
+    constexpr float albedo_floor = 1e-2f;
+
+    constexpr float b3[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+    glm::vec3 demodulation(const glm::vec3& albedo)
+    {
+        return glm::max(albedo, glm::vec3(albedo_floor));
+    }
+}
+
+void RT::Denoiser::prepare(const Frame& in, thread_pool& pool)
+{
+    const size_t w = in.w(), h = in.h();
+
+    pool.parallelize_loop(size_t(0), h, [&](size_t begin, size_t end)
+        {
+            RT_TRACE_SCOPE("denoise prepare");
+            for (size_t y = begin; y < end; y++)
+            {
+                for (size_t x = 0; x < w; x++)
+                {
+                    const size_t i = x + y * w;
+                    const uint32_t n = in.counts[i];
+                    Feature& f = features[i];
+                    if (n == 0)
+                    {
+                        f = { glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, 0.0f, false };
+                        ping[i] = { glm::vec3(0.0f), 0.0f };
+                        continue;
+                    }
+
+                    // guides are averaged over antialiasing jitter, so normal is renormalized
+                    const Guide g = in.mean_guide(x, y);
+                    const float length = glm::length(g.normal);
+                    f = { g.albedo, length > 1e-6f ? g.normal / length : glm::vec3(0.0f), g.depth, 0.0f, true };
+
+                    // variance of the mean, demodulated the same way as color
+                    const glm::vec3 mean = in.mean(x, y);
+                    const float l = Frame::luminance(mean);
+                    const float a = std::max(Frame::luminance(f.albedo), albedo_floor);
+                    const float var = std::max(0.0f, in.raw_sq[i] / n - l * l) / n;
+                    ping[i] = { mean / demodulation(f.albedo), var / (a * a) };
+                }
+            }
+        });
+
+    // smaller of one sided differences, so depth edges do not widen the gradient of pixels next to them
+    auto difference = [&](size_t i, size_t a, size_t b)
+    {
+        float d = INFINITY;
+        if (features[a].valid && features[a].depth > 0.0f)
+            d = std::min(d, std::abs(features[a].depth - features[i].depth));
+        if (features[b].valid && features[b].depth > 0.0f)
+            d = std::min(d, std::abs(features[b].depth - features[i].depth));
+        return d;
+    };
+
+    pool.parallelize_loop(size_t(0), h, [&](size_t begin, size_t end)
+        {
+            RT_TRACE_SCOPE("denoise gradient");
+            for (size_t y = begin; y < end; y++)
+            {
+                for (size_t x = 0; x < w; x++)
+                {
+                    const size_t i = x + y * w;
+                    if (!features[i].valid || features[i].depth <= 0.0f)
+                        continue;
+
+                    const float dx = difference(i, x > 0 ? i - 1 : i, x + 1 < w ? i + 1 : i);
+                    const float dy = difference(i, y > 0 ? i - w : i, y + 1 < h ? i + w : i);
+                    const float gradient = std::max(std::isinf(dx) ? 0.0f : dx, std::isinf(dy) ? 0.0f : dy);
+                    features[i].gradient = gradient;
+                }
+            }
+        });
+}
+
+void RT::Denoiser::blur_variance(const std::vector<Texel>& src, size_t w, size_t h, thread_pool& pool)
+{
+    constexpr float kernel[3] = { 0.25f, 0.5f, 0.25f };
+
+    pool.parallelize_loop(size_t(0), h, [&](size_t begin, size_t end)
+        {
+            RT_TRACE_SCOPE("denoise variance");
+            for (size_t y = begin; y < end; y++)
+            {
+                for (size_t x = 0; x < w; x++)
+                {
+                    float sum = 0.0f, total = 0.0f;
+                    for (int dy = -1; dy <= 1; dy++)
+                    {
+                        const long qy = long(y) + dy;
+                        if (qy < 0 || qy >= long(h))
+                            continue;
+                        for (int dx = -1; dx <= 1; dx++)
+                        {
+                            const long qx = long(x) + dx;
+                            if (qx < 0 || qx >= long(w) || !features[qx + qy * w].valid)
+                                continue;
+                            const float k = kernel[dx + 1] * kernel[dy + 1];
+                            sum += k * src[qx + qy * w].variance;
+                            total += k;
+                        }
+                    }
+                    variance[x + y * w] = total > 0.0f ? sum / total : 0.0f;
+                }
+            }
+        });
+}
+
+void RT::Denoiser::pass(const std::vector<Texel>& src, std::vector<Texel>& dst, size_t w, size_t h, int step, thread_pool& pool) const
+{
+    pool.parallelize_loop(size_t(0), h, [&](size_t begin, size_t end)
+        {
+            RT_TRACE_SCOPE("denoise pass");
+            for (size_t y = begin; y < end; y++)
+            {
+                for (size_t x = 0; x < w; x++)
+                {
+                    const size_t i = x + y * w;
+                    const Feature& p = features[i];
+                    if (!p.valid)
+                    {
+                        dst[i] = { glm::vec3(0.0f), 0.0f };
+                        continue;
+                    }
+
+                    const float lp = Frame::luminance(src[i].color);
+                    const float luminance_scale = settings.sigma_luminance * std::sqrt(variance[i]) + 1e-6f;
+                    const bool sky = p.depth <= 0.0f;
+
+                    glm::vec3 color(0.0f);
+                    float var = 0.0f, total = 0.0f;
+                    for (int ky = -2; ky <= 2; ky++)
+                    {
+                        const long qy = long(y) + ky * step;
+                        if (qy < 0 || qy >= long(h))
+                            continue;
+                        for (int kx = -2; kx <= 2; kx++)
+                        {
+                            const long qx = long(x) + kx * step;
+                            if (qx < 0 || qx >= long(w))
+                                continue;
+
+                            const size_t j = qx + qy * w;
+                            const Feature& q = features[j];
+                            if (!q.valid || sky != (q.depth <= 0.0f))
+                                continue;
+
+                            float weight = b3[kx + 2] * b3[ky + 2];
+                            if (!sky)
+                            {
+                                const float distance = static_cast<float>(step) * std::max(std::abs(kx), std::abs(ky));
+                                const float depth_scale = settings.sigma_depth * p.gradient * distance + 1e-3f * p.depth;
+                                weight *= std::pow(std::max(0.0f, glm::dot(p.normal, q.normal)), settings.sigma_normal);
+                                weight *= std::exp(-std::abs(p.depth - q.depth) / depth_scale);
+                            }
+                            weight *= std::exp(-std::abs(lp - Frame::luminance(src[j].color)) / luminance_scale);
+
+                            color += weight * src[j].color;
+                            var += weight * weight * src[j].variance;
+                            total += weight;
+                        }
+                    }
+
+                    // center tap always has weight 1 * b3 center, so total is never 0
+                    dst[i] = { color / total, var / (total * total) };
+                }
+            }
+        });
+}
+
+void RT::Denoiser::denoise(const Frame& in, Frame& out, thread_pool& pool)
+{
+    const size_t w = in.w(), h = in.h(), size = w * h;
+
+    ping.resize(size);
+    pong.resize(size);
+    features.resize(size);
+    variance.resize(size);
+
+    prepare(in, pool);
+    for (int k = 0; k < settings.passes; k++)
+    {
+        blur_variance(ping, w, h, pool);
+        pass(ping, pong, w, h, 1 << k, pool);
+        std::swap(ping, pong);
+    }
+
+    out.img_w = w;
+    out.raw.resize(size);
+    out.raw_sq.resize(size);
+    out.counts.resize(size);
+    out.position = in.position;
+    out.guide.resize(size);
+    out.block_epoch.assign(in.block_epoch.size(), in.epoch);
+    out.samples = in.samples;
+    out.epoch = in.epoch;
+
+    pool.parallelize_loop(size_t(0), h, [&](size_t begin, size_t end)
+        {
+            RT_TRACE_SCOPE("denoise output");
+            for (size_t y = begin; y < end; y++)
+            {
+                for (size_t x = 0; x < w; x++)
+                {
+                    const size_t i = x + y * w;
+                    const bool valid = features[i].valid;
+                    const glm::vec3 color = ping[i].color * demodulation(features[i].albedo);
+                    out.raw[i] = color;
+                    out.raw_sq[i] = Frame::luminance(color) * Frame::luminance(color);
+                    out.counts[i] = valid ? 1 : 0;
+                    out.guide[i] = in.mean_guide(x, y);
+                }
+            }
+        });
+}
+
+void RT::BackgroundDenoiser::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        wake.wait(guard, [&] { return stopping || pending; });
+        if (stopping)
+            return;
+
+        pending = false;
+        busy = true;
+        const uint64_t job = input_generation;
+
+        guard.unlock();
+        {
+            RT_TRACE_SCOPE("denoise");
+            denoiser.denoise(input, working, pool);
+        }
+        guard.lock();
+
+        busy = false;
+        if (job == generation)
+        {
+            std::swap(working, done);
+            fresh = true;
+        }
+    }
+}
+
+bool RT::BackgroundDenoiser::submit(const Frame& frame)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (busy || pending)
+            return false;
+    }
+
+    // idle worker does not touch `input` and only this thread starts it
+    input = frame;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        input_generation = generation;
+        pending = true;
+    }
+    wake.notify_one();
+    return true;
+}
+
+const RT::Frame* RT::BackgroundDenoiser::acquire()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (!fresh)
+        return nullptr;
+
+    std::swap(done, front);
+    fresh = false;
+    return &front;
+}
+
+void RT::BackgroundDenoiser::discard()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    generation += 1;
+    fresh = false;
+}
+
+RT::BackgroundDenoiser::~BackgroundDenoiser()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
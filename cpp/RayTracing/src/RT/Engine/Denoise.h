@@ -0,0 +1,126 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <glm.hpp>
+
+#include "../../Utils/thread_pool.hpp"
+#include "RenderTarget.h"
+
+namespace RT
+{
+    struct DenoiseSettings
+    {
+        // number of a-trous passes, kernel footprint doubles with each one (5 passes cover 125 x 125 pixels)
+        int passes = 5;
+        // edge stopping on luminance difference, in standard deviations of pixel noise
+        float sigma_luminance = 4.0f;
+        // exponent of normal similarity, higher keeps creases sharper
+        float sigma_normal = 128.0f;
+        // edge stopping on depth difference, relative to depth change expected from screen space gradient
+        float sigma_depth = 1.0f;
+    };
+
+    /// <summary>
+    /// Edge-avoiding a-trous wavelet filter (SVGF style, spatial part only). Noisy irradiance is demodulated by
+    /// albedo of primary hit, so texture detail does not get blurred, and filtered with 5x5 B3 spline kernel whose
+    /// taps are spread further apart every pass. Taps across edges are rejected by normal and depth guides,
+    /// luminance weight is scaled by per pixel variance estimate, which is filtered together with the color.
+    /// </summary>
+    class Denoiser
+    {
+        struct Texel
+        {
+            glm::vec3 color;
+            float variance;
+        };
+
+        struct Feature
+        {
+            glm::vec3 albedo;
+            // unit length, zero for sky and unsampled pixels
+            glm::vec3 normal;
+            float depth;
+            // expected depth change per pixel
+            float gradient;
+            bool valid;
+        };
+
+        DenoiseSettings settings;
+        std::vector<Texel> ping, pong;
+        std::vector<Feature> features;
+        // variance blurred by 3x3 gaussian, drives luminance weight of current pass
+        std::vector<float> variance;
+
+        void prepare(const Frame& in, thread_pool& pool);
+        void blur_variance(const std::vector<Texel>& src, size_t w, size_t h, thread_pool& pool);
+        void pass(const std::vector<Texel>& src, std::vector<Texel>& dst, size_t w, size_t h, int step, thread_pool& pool) const;
+
+    public:
+        void configure(const DenoiseSettings& new_settings) { settings = new_settings; }
+        const DenoiseSettings& get_settings() const { return settings; }
+
+        /// <summary>
+        /// Filters mean of every pixel of `in` into `out` (resized to match). `out` holds one sample per sampled pixel
+        /// and every block is stamped with epoch of `in`, so it can be resolved like any accumulated frame.
+        /// </summary>
+        void denoise(const Frame& in, Frame& out, thread_pool& pool);
+    };
+
+    /// <summary>
+    /// Runs `Denoiser` on its own thread and pool, so interactive caller never waits for the filter.
+    /// `submit` copies frame only while the filter is idle, finished output is handed over by `acquire`
+    /// the way `RenderTarget` hands over frames. Both are meant to be called from one thread.
+    /// </summary>
+    class BackgroundDenoiser
+    {
+        Denoiser denoiser;
+        thread_pool pool;
+
+        // worker reads `input` and fills `working` only while busy
+        Frame input;
+        Frame working;
+        // finished output not acquired yet, and the one returned by last `acquire`
+        Frame done;
+        Frame front;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        bool pending = false;
+        bool busy = false;
+        bool fresh = false;
+        bool stopping = false;
+        // results of frames submitted before last `discard` are dropped
+        uint64_t generation = 0;
+        uint64_t input_generation = 0;
+        std::thread worker;
+
+        void run();
+
+    public:
+        explicit BackgroundDenoiser(uint32_t threads) : pool(threads), worker(&BackgroundDenoiser::run, this) {}
+        // waits for running filter
+        ~BackgroundDenoiser();
+
+        BackgroundDenoiser(const BackgroundDenoiser&) = delete;
+        BackgroundDenoiser& operator=(const BackgroundDenoiser&) = delete;
+
+        /// <summary>
+        /// Copies `frame` and starts filtering it, returns false without copying if previous one is still filtered
+        /// </summary>
+        bool submit(const Frame& frame);
+
+        /// <summary>
+        /// Returns newest finished output, or nullptr if nothing finished since last call.
+        /// Returned frame stays valid and unchanged until next `acquire`.
+        /// </summary>
+        const Frame* acquire();
+
+        /// <summary>
+        /// Drops finished and running results, eg. when filtering was switched off and on
+        /// </summary>
+        void discard();
+    };
+}
@@ -1,12 +1,17 @@
 #pragma once
 #include <thread>
+#include <mutex>
 #include <glm.hpp>
 #include "../../Utils/thread_pool.hpp"
+#include "../../Utils/Trace.h"
 #include "../Camera/Camera.h"
 #include "../Camera/Ray.h"
 #include "../Primitives/Hittable.h"
 #include "shade.h"
-#include "GuardedRenderTarget.h"
+#include "RenderTarget.h"
+#include "TileScheduler.h"
+#include "Wavefront.h"
+#include "Stats.h"
 
 namespace RT
 {
@@ -14,6 +19,8 @@ namespace RT
     {
         std::optional<Cam::Camera> camera;
         std::optional<std::reference_wrapper<Primitives::IHittable>> world;
+        std::optional<std::reference_wrapper<const Mat::MaterialTable>> materials;
+        std::optional<std::reference_wrapper<const Primitives::LightList>> lights;
     };
 
     using real_milliseconds = std::chrono::duration<double, std::ratio<1, 1000>>;
@@ -32,15 +39,62 @@ namespace RT
         int _max_iterations;
         int _max_bounces;
 
-        // worker thread will render to this texture
-        GuardedRenderTarget& render_target;
+        // worker thread will render to this texture, every finished iteration is published
+        RenderTarget& render_target;
 
-        // RND for rendering
-        std::uniform_real_distribution<float> uniform;
-        std::mt19937 random;
+        // Base seed, every pixel sample derives its own sampler from (seed, pixel, sample index)
+        uint64_t _seed;
+
+        // Sample sequence of pixel and bounce decisions
+        std::atomic<Utils::SamplerType> _sampler;
         
         real_milliseconds _total_render_time;
+        std::vector<real_milliseconds> _iteration_times;
+        std::atomic<uint64_t> _traced_rays;
+
+        // statistics of iterations published since last camera reset, read by other threads through `get_stats`
+        std::mutex stats_lock;
+        RenderStats _stats;
            
+        // Splits every iteration into tiles, only render thread touches it
+        TileScheduler scheduler;
+        std::atomic<uint32_t> _tile_size;
+
+        // Trace primary rays in 2x2 packets
+        std::atomic_bool _packet_tracing;
+
+        // Terminate low contribution paths early
+        std::atomic_bool _russian_roulette;
+
+        // Sample lights directly at diffuse hits
+        std::atomic_bool _next_event;
+
+        // Advance all paths of tile stage by stage instead of one path at a time (overrides packet tracing)
+        std::atomic_bool _wavefront;
+
+        // Adaptive sampling - pixels with `Frame::relative_error` below target stop sampling, 0 disables it
+        std::atomic<float> _noise_target;
+        // pixels sampled in last finished iteration and in the running one
+        std::atomic<uint64_t> _active_pixels;
+        std::atomic<uint64_t> _sampled_pixels;
+        // pixels that will not be sampled anymore, rebuilt by render thread after every iteration
+        std::vector<uint8_t> _converged;
+
+        // Temporal reprojection - on camera change samples of last frame are reused where they still see the same surface
+        std::atomic_bool _reprojection;
+        std::atomic<uint64_t> _reprojected_pixels;
+        // last frame of previous view, only valid until first iteration of new view is published
+        const Frame* history = nullptr;
+        std::optional<Cam::Camera> history_camera;
+
+        // Progressive preview - after camera change low resolution iterations are rendered until full one fits
+        // into budget (ms), 0 disables it
+        std::atomic<float> _preview_budget;
+        // side of pixel block traced by one sample in next iteration, 1 is full resolution
+        std::atomic<int> _preview_level;
+        // wall time of last full resolution iteration, 0 if not measured yet
+        float full_iteration_ms = 0.0f;
+
         // Flag for updateing camera
         std::atomic_bool _update_camera;
         std::optional<Cam::Camera> new_camera;
@@ -48,14 +102,28 @@ namespace RT
         bool should_run;
         World renderable_world;
 
-        RTRenderer(GuardedRenderTarget& image, int max_iters, int _max_bounces, int _max_workers) :
-            render_target(image),
-            uniform(0.0f, 1.0f),
-            _total_render_time(0),
+        RTRenderer(RenderTarget& image, int max_iters, int _max_bounces, int _max_workers, uint64_t seed = 0) :
+            _max_workers(_max_workers),
             _iterations(0),
-            _max_bounces(_max_bounces),
             _max_iterations(max_iters),
-            _max_workers(_max_workers)
+            _max_bounces(_max_bounces),
+            render_target(image),
+            _seed(seed),
+            _sampler(Utils::SamplerType::Sobol),
+            _total_render_time(0),
+            _traced_rays(0),
+            _tile_size(16),
+            _packet_tracing(true),
+            _russian_roulette(true),
+            _next_event(true),
+            _wavefront(false),
+            _noise_target(0.0f),
+            _active_pixels(0),
+            _sampled_pixels(0),
+            _reprojection(false),
+            _reprojected_pixels(0),
+            _preview_budget(0.0f),
+            _preview_level(1)
         {
             should_run = true;
             render_thread = std::thread([&]() { render_loop(); });
@@ -63,19 +131,102 @@ namespace RT
 
         void request_camera_update(Cam::Camera _new_camera)
         {
+            RT_TRACE_INSTANT("camera request");
             new_camera = _new_camera;
             _update_camera = true;
         }
 
-        void request_world_update(Primitives::IHittable& world)
+        void request_world_update(Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights)
         {
+            renderable_world.materials = materials;
+            renderable_world.lights = lights;
             renderable_world.world = world;
         }
 
+        /// <summary>
+        /// Side of square render tile in pixels, applied from next iteration
+        /// </summary>
+        void request_tile_size(uint32_t size)
+        {
+            _tile_size = size;
+        }
+
+        void request_packet_tracing(bool enabled)
+        {
+            _packet_tracing = enabled;
+        }
+
+        void request_russian_roulette(bool enabled)
+        {
+            _russian_roulette = enabled;
+        }
+
+        void request_next_event(bool enabled)
+        {
+            _next_event = enabled;
+        }
+
+        void request_wavefront(bool enabled)
+        {
+            _wavefront = enabled;
+        }
+
+        /// <summary>
+        /// Sampler of pixel positions and bounce decisions, applied from next iteration.
+        /// Samples already accumulated are kept, new ones continue sequence of each pixel from its sample count.
+        /// </summary>
+        void request_sampler(Utils::SamplerType type)
+        {
+            _sampler = type;
+        }
+
+        Utils::SamplerType get_sampler()
+        {
+            return _sampler;
+        }
+
+        /// <summary>
+        /// Enables noise-target mode: pixel stops sampling once standard error of its mean luminance divided by
+        /// square root of the mean (`Frame::relative_error`) falls below `target`. Error of bright pixels may be
+        /// larger than `target` times the mean, of dark ones smaller. Rendering is done when every pixel converged
+        /// (or after max iterations). 0 returns to fixed iteration count.
+        /// </summary>
+        void request_noise_target(float target)
+        {
+            _noise_target = target;
+        }
+
+        /// <summary>
+        /// On camera change pixels that see the same surface (or sky) as in previous view keep up to
+        /// `reprojection_max_history` of their samples, only disoccluded pixels start from scratch.
+        /// </summary>
+        void request_reprojection(bool enabled)
+        {
+            _reprojection = enabled;
+        }
+
+        /// <summary>
+        /// Enables progressive preview: after camera change frame is traced at 1/8, 1/4 or 1/2 resolution (one sample
+        /// fills whole block) and refined level by level. Starting level and every next one are chosen from measured
+        /// iteration times, so iteration fits into `budget_ms` if possible. Full resolution accumulation starts after that.
+        /// Temporal reprojection is used only if camera change goes straight to full resolution. 0 disables preview.
+        /// </summary>
+        void request_preview(float budget_ms)
+        {
+            _preview_budget = budget_ms;
+        }
+
+        /// <summary>
+        /// Side of pixel block of frame being rendered (1 once preview reached full resolution)
+        /// </summary>
+        int get_preview_level()
+        {
+            return _preview_level;
+        }
+
         void kill_render_thread()
         {
             should_run = false;
-            render_target.stop();
             render_thread.join();
         }
 
@@ -94,68 +245,584 @@ namespace RT
         }
         bool is_done()
         {
-            return _iterations >= _max_iterations;
+            if (_iterations >= _max_iterations)
+                return true;
+            return _noise_target > 0.0f && _iterations >= static_cast<int>(adaptive_min_samples) && _active_pixels == 0;
+        }
+
+        /// <summary>
+        /// Pixels that were sampled in last iteration (all of them unless adaptive sampling is on)
+        /// </summary>
+        uint64_t get_active_pixels()
+        {
+            return _active_pixels;
+        }
+
+        /// <summary>
+        /// Pixels that reused samples of previous view after last camera change
+        /// </summary>
+        uint64_t get_reprojected_pixels()
+        {
+            return _reprojected_pixels;
+        }
+
+        /// <summary>
+        /// Rays traced (primary and secondary) since last camera reset
+        /// </summary>
+        uint64_t get_traced_rays()
+        {
+            return _traced_rays;
+        }
+
+        /// <summary>
+        /// Wall time of every iteration since last camera reset.
+        /// Not synchronized - read only after `kill_render_thread`.
+        /// </summary>
+        const std::vector<RT::real_milliseconds>& get_iteration_times()
+        {
+            return _iteration_times;
+        }
+
+        /// <summary>
+        /// Copy of per iteration counters and worker times since last camera reset, safe to call any time
+        /// </summary>
+        RenderStats get_stats()
+        {
+            std::lock_guard<std::mutex> guard(stats_lock);
+            return _stats;
+        }
+
+        /// <summary>
+        /// Tiles of last iteration with their render time.
+        /// Not synchronized - read only after `kill_render_thread`.
+        /// </summary>
+        std::vector<TileCost> get_tile_costs()
+        {
+            return scheduler.tile_costs();
         }
 
+        // samples every pixel takes before adaptive sampling can stop it
+        static constexpr uint32_t adaptive_min_samples = 16;
+        // upper bound of samples per pixel in one iteration, when converged pixels leave their budget to others
+        static constexpr uint32_t adaptive_max_boost = 16;
+        // samples of previous view pixel keeps at most, older lighting of view dependent materials fades out quickly
+        static constexpr uint32_t reprojection_max_history = 16;
+        // history is rejected if its hit is further from new hit than this fraction of distance to camera
+        static constexpr float reprojection_tolerance = 0.02f;
+        // coarsest preview, one sample per 8x8 pixels
+        static constexpr int preview_max_level = 8;
+
     private:
 
-        std::pair<float, float> get_uv(float x, float y, std::pair<size_t, size_t> wh)
+        PathSettings path_settings() const
         {
-            const float u = ((y + uniform(random)) / (wh.second - 1) - 0.5f) * 2.0f;
-            const float v = ((x + uniform(random)) / (wh.first - 1) - 0.5f) * 2.0f;
+            PathSettings settings;
+            settings.max_bounces = _max_bounces;
+            settings.roulette = _russian_roulette;
+            settings.next_event = _next_event;
+            return settings;
+        }
+
+        /// <summary>
+        /// True if pixel should not be sampled anymore, see `update_converged`
+        /// </summary>
+        bool converged(const Frame* previous, float noise_target, size_t x, size_t y) const
+        {
+            return noise_target > 0.0f && previous != nullptr && !_converged.empty() && _converged[x + y * previous->w()];
+        }
+
+        /// <summary>
+        /// Marks pixels of `frame` that reached noise target (or max samples). Single pixel estimate is unreliable
+        /// for rare bright paths (caustics), so pixel stops only if all its neighbours are below target too.
+        /// </summary>
+        void update_converged(const Frame& frame, float noise_target)
+        {
+            const size_t w = frame.w();
+            const size_t h = frame.h();
+            if (noise_target <= 0.0f)
+            {
+                _converged.clear();
+                return;
+            }
+
+            // below target on its own
+            std::vector<uint8_t> below(w * h);
+            for (size_t y = 0; y < h; y++)
+            {
+                for (size_t x = 0; x < w; x++)
+                {
+                    const uint32_t count = frame.get_count(x, y);
+                    below[x + y * w] = count >= static_cast<uint32_t>(_max_iterations)
+                        || (count >= adaptive_min_samples && frame.relative_error(x, y) < noise_target);
+                }
+            }
+
+            // 3x3 erosion
+            _converged.assign(w * h, 0);
+            for (size_t y = 0; y < h; y++)
+            {
+                for (size_t x = 0; x < w; x++)
+                {
+                    if (frame.get_count(x, y) >= static_cast<uint32_t>(_max_iterations))
+                    {
+                        _converged[x + y * w] = 1;
+                        continue;
+                    }
+
+                    bool all = true;
+                    for (size_t ny = (y == 0 ? 0 : y - 1); ny <= std::min(y + 1, h - 1) && all; ny++)
+                        for (size_t nx = (x == 0 ? 0 : x - 1); nx <= std::min(x + 1, w - 1) && all; nx++)
+                            all = below[nx + ny * w] != 0;
+                    _converged[x + y * w] = all;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Samples per pixel for next iteration. With adaptive sampling iteration keeps roughly
+        /// the same cost - budget of converged pixels is spread over these still being sampled.
+        /// </summary>
+        int samples_per_pixel(size_t pixels) const
+        {
+            if (_noise_target <= 0.0f || _iterations < static_cast<int>(adaptive_min_samples))
+                return 1;
+            const uint64_t active = std::max<uint64_t>(_active_pixels, 1);
+            return static_cast<int>(std::clamp<uint64_t>(pixels / active, 1, adaptive_max_boost));
+        }
+
+        /// <summary>
+        /// Finest preview level (power of 2, at most `limit`) whose estimated iteration time fits into budget,
+        /// `full_ms` is estimated time of full resolution iteration.
+        /// </summary>
+        int preview_level_for(float full_ms, int limit) const
+        {
+            const float budget = _preview_budget;
+            int level = 1;
+            while (level < limit && full_ms / (level * level) > budget)
+                level *= 2;
+            return level;
+        }
+
+        /// <summary>
+        /// Sampler of `sample`-th sample of pixel in running iteration, its index continues after samples of the pixel in `previous`
+        /// </summary>
+        Utils::Sampler pixel_sampler(Utils::SamplerType type, const Frame* previous, uint32_t x, uint32_t y, size_t sample) const
+        {
+            const uint32_t index = (previous ? previous->get_count(x, y) : 0) + static_cast<uint32_t>(sample);
+            return Utils::Sampler(type, _seed, x, y, index);
+        }
+
+        std::pair<float, float> get_uv(float x, float y, std::pair<size_t, size_t> wh, Utils::Sampler& sampler)
+        {
+            const glm::vec2 jitter = sampler.get2d();
+            const float u = ((y + jitter.y) / (wh.second - 1) - 0.5f) * 2.0f;
+            const float v = ((x + jitter.x) / (wh.first - 1) - 0.5f) * 2.0f;
 
             return { u, v };
         }
 
-        void trace_indexes(GuardedRenderTarget::Surf& surf, int samples, int _bounces, const Cam::Camera& camera, const Primitives::IHittable& world, int from, int to)
+        /// <summary>
+        /// Inverse of `get_uv` - pixel whose sampled area contains `uv`, nullopt if it is outside of image
+        /// </summary>
+        std::optional<std::pair<size_t, size_t>> get_pixel(const glm::vec2& uv, std::pair<size_t, size_t> wh) const
+        {
+            const float y = (uv.x * 0.5f + 0.5f) * (wh.second - 1);
+            const float x = (uv.y * 0.5f + 0.5f) * (wh.first - 1);
+            // negated so NaN fails too
+            if (!(x >= 0.0f && y >= 0.0f && x < wh.first && y < wh.second))
+                return std::nullopt;
+            return std::make_pair(static_cast<size_t>(x), static_cast<size_t>(y));
+        }
+
+        /// <summary>
+        /// Adds samples of `history` (rendered by `old_camera`) to first iteration of new view. Primary hit of every
+        /// pixel is projected to old view, history of pixel there is reused if it hit the same point (or sky too).
+        /// </summary>
+        void reproject(Frame& frame, const Frame& history, const Cam::Camera& old_camera, const Cam::Camera& camera, thread_pool& pool)
+        {
+            const auto wh = std::make_pair(frame.w(), frame.h());
+
+            pool.parallelize_loop(size_t(0), frame.h(), [&](size_t y0, size_t y1)
+                {
+                    RT_TRACE_SCOPE("reproject rows");
+                    uint64_t reused = 0;
+                    for (size_t y = y0; y < y1; y++)
+                    {
+                        for (size_t x = 0; x < frame.w(); x++)
+                        {
+                            const size_t i = x + y * frame.w();
+                            const glm::vec4 p = frame.position[i];
+                            const bool surface = p.w != 0.0f;
+
+                            // unsampled pixel has zero direction, camera rejects it as well
+                            const auto uv = old_camera.project(surface ? glm::vec3(p) - old_camera.origin : glm::vec3(p));
+                            if (!uv.has_value())
+                                continue;
+                            const auto pixel = get_pixel(*uv, wh);
+                            if (!pixel.has_value())
+                                continue;
+
+                            const size_t j = pixel->first + pixel->second * frame.w();
+                            const glm::vec4 q = history.position[j];
+                            const uint32_t n = history.counts[j];
+                            if (n == 0 || q.w != p.w)
+                                continue;
+                            if (surface && glm::length(glm::vec3(p) - glm::vec3(q)) > reprojection_tolerance * glm::length(glm::vec3(p) - camera.origin))
+                                continue;
+
+                            const uint32_t kept = std::min(n, reprojection_max_history);
+                            const float weight = static_cast<float>(kept) / n;
+                            frame.raw[i] += history.raw[j] * weight;
+                            frame.raw_sq[i] += history.raw_sq[j] * weight;
+                            frame.guide[i] += history.guide[j] * weight;
+                            frame.counts[i] += kept;
+                            reused += 1;
+                        }
+                    }
+                    _reprojected_pixels += reused;
+                });
+        }
+
+        void trace_tile(Frame& frame, const Frame* previous, int samples, const Cam::Camera& camera, const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, const Tile& tile)
         {
-            for (size_t i = from; i < to; i++)
+            size_t rays = 0;
+            uint64_t active = 0;
+            const PathSettings settings = path_settings();
+            const float noise_target = _noise_target;
+            const Utils::SamplerType sampler_type = _sampler;
+            const auto wh = std::make_pair(frame.w(), frame.h());
+
+            for (uint32_t y = tile.y0; y < tile.y1; y++)
             {
-                const int x = i % surf.w();
-                const int y = i / surf.w();
+                for (uint32_t x = tile.x0; x < tile.x1; x++)
+                {
+                    if (converged(previous, noise_target, x, y))
+                    {
+                        frame.accumulate(previous, x, y, glm::vec3(0.0f), 0.0f, 0, {});
+                        continue;
+                    }
 
-                glm::vec3 color = { 0.0f, 0.0f, 0.0f };
+                    glm::vec3 color = { 0.0f, 0.0f, 0.0f };
+                    PrimaryHit primary;
+                    Guide guide;
+                    float sq = 0.0f;
 
-                for (size_t sample = 0; sample < samples; sample++)
+                    for (int sample = 0; sample < samples; sample++)
+                    {
+                        Utils::Sampler sampler = pixel_sampler(sampler_type, previous, x, y, sample);
+                        const auto [u, v] = get_uv(float(x), float(y), wh, sampler);
+
+                        const auto r = camera.genray({ u, v });
+
+                        const glm::vec3 c = gen_color(r, world, materials, lights, sampler, settings, rays, &primary);
+                        color += c;
+                        guide += primary.guide;
+                        sq += Frame::luminance(c) * Frame::luminance(c);
+                    }
+                    frame.accumulate(previous, x, y, color, sq, samples, guide);
+                    frame.set_position(x, y, primary.position);
+                    active += 1;
+                }
+            }
+            _traced_rays += rays;
+            _sampled_pixels += active;
+        }
+
+        /// <summary>
+        /// Same as trace_tile, but primary rays of every 2x2 pixel quad are intersected as one RayPacket.
+        /// Secondary bounces are incoherent and continue on scalar path.
+        /// </summary>
+        void trace_tile_packets(Frame& frame, const Frame* previous, int samples, const Cam::Camera& camera, const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, const Tile& tile)
+        {
+            size_t rays = 0;
+            uint64_t active_pixels = 0;
+            const PathSettings settings = path_settings();
+            const float noise_target = _noise_target;
+            const Utils::SamplerType sampler_type = _sampler;
+            const auto wh = std::make_pair(frame.w(), frame.h());
+
+            for (uint32_t y = tile.y0; y < tile.y1; y += 2)
+            {
+                for (uint32_t x = tile.x0; x < tile.x1; x += 2)
                 {
-                    const auto [u, v] = get_uv(float(x), float(y), std::make_pair(surf.w(), surf.h()));
+                    uint32_t px[RayPacket::width], py[RayPacket::width];
+                    int active = 0;
+                    for (int lane = 0; lane < RayPacket::width; lane++)
+                    {
+                        px[lane] = x + (lane & 1);
+                        py[lane] = y + (lane >> 1);
+                        if (px[lane] < tile.x1 && py[lane] < tile.y1)
+                        {
+                            if (!converged(previous, noise_target, px[lane], py[lane]))
+                                active |= 1 << lane;
+                            else
+                                frame.accumulate(previous, px[lane], py[lane], glm::vec3(0.0f), 0.0f, 0, {});
+                        }
+                        else
+                        {
+                            px[lane] = x;
+                            py[lane] = y;
+                        }
+                    }
+
+                    if (active == 0)
+                        continue;
+
+                    glm::vec3 color[RayPacket::width] = {};
+                    glm::vec4 position[RayPacket::width] = {};
+                    Guide guide[RayPacket::width] = {};
+                    float sq[RayPacket::width] = {};
+
+                    for (int sample = 0; sample < samples; sample++)
+                    {
+                        auto lane_sampler = [&](int lane) { return pixel_sampler(sampler_type, previous, px[lane], py[lane], sample); };
+                        Utils::Sampler sampler[RayPacket::width] = { lane_sampler(0), lane_sampler(1), lane_sampler(2), lane_sampler(3) };
+
+                        auto primary = [&](int lane)
+                        {
+                            const auto [u, v] = get_uv(float(px[lane]), float(py[lane]), wh, sampler[lane]);
+                            return camera.genray({ u, v });
+                        };
+                        const ray r[RayPacket::width] = { primary(0), primary(1), primary(2), primary(3) };
 
-                    const auto r = camera.genray({ u, v });
+                        Primitives::HitPacket hits(std::numeric_limits<float>::infinity());
+                        world.intersect_packet(RayPacket(r, active), 0.001f, hits);
 
-                    color += gen_color(r, world, random, _max_bounces);
+                        for (int lane = 0; lane < RayPacket::width; lane++)
+                        {
+                            if ((active >> lane & 1) == 0)
+                                continue;
+                            rays += 1;
+                            Utils::thread_counters.primary_rays += 1;
+                            const PrimaryHit primary = primary_hit(r[lane], hits.rec[lane] ? &*hits.rec[lane] : nullptr, materials);
+                            position[lane] = primary.position;
+                            guide[lane] += primary.guide;
+                            if (!hits.rec[lane])
+                                Utils::thread_counters.end_path(0, true);
+                            const glm::vec3 c = hits.rec[lane] ? shade_hit(r[lane], *hits.rec[lane], world, materials, lights, sampler[lane], settings, rays) : sky(r[lane]);
+                            color[lane] += c;
+                            sq[lane] += Frame::luminance(c) * Frame::luminance(c);
+                        }
+                    }
+
+                    for (int lane = 0; lane < RayPacket::width; lane++)
+                    {
+                        if (active >> lane & 1)
+                        {
+                            frame.accumulate(previous, px[lane], py[lane], color[lane], sq[lane], samples, guide[lane]);
+                            frame.set_position(px[lane], py[lane], position[lane]);
+                            active_pixels += 1;
+                        }
+                    }
                 }
-                surf.get_pixel(x, y) += color;
             }
+            _traced_rays += rays;
+            _sampled_pixels += active_pixels;
+        }
+
+        /// <summary>
+        /// Same as trace_tile, but paths of whole tile are traced by wavefront stages.
+        /// </summary>
+        void trace_tile_wavefront(Frame& frame, const Frame* previous, int samples, const Cam::Camera& camera, const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, const Tile& tile)
+        {
+            thread_local Wavefront wavefront;
+
+            size_t rays = 0;
+            uint64_t active = 0;
+            const float noise_target = _noise_target;
+            const Utils::SamplerType sampler_type = _sampler;
+            const auto wh = std::make_pair(frame.w(), frame.h());
+
+            // every sample is one wavefront pass, later passes accumulate on top of the frame itself
+            for (int pass = 0; pass < samples; pass++)
+            {
+                const Frame* base = pass == 0 ? previous : &frame;
+                auto sampler = [&](uint32_t x, uint32_t y) { return pixel_sampler(sampler_type, previous, x, y, pass); };
+                auto camera_ray = [&](uint32_t x, uint32_t y, Utils::Sampler& sampler) -> std::optional<ray>
+                {
+                    if (converged(previous, noise_target, x, y))
+                        return {};
+                    const auto [u, v] = get_uv(float(x), float(y), wh, sampler);
+                    return camera.genray({ u, v });
+                };
+                auto accumulate = [&](uint32_t x, uint32_t y, const glm::vec3& color, const PrimaryHit& primary, bool sampled)
+                {
+                    const float l = Frame::luminance(color);
+                    frame.accumulate(base, x, y, color, l * l, sampled ? 1 : 0, sampled ? primary.guide : Guide());
+                    if (sampled)
+                        frame.set_position(x, y, primary.position);
+                    active += pass == 0 && sampled ? 1 : 0;
+                };
+
+                wavefront.trace(tile, sampler, world, materials, lights, path_settings(), camera_ray, accumulate, rays);
+            }
+            _traced_rays += rays;
+            _sampled_pixels += active;
+        }
+
+        /// <summary>
+        /// Preview iteration - one sample per `level` x `level` pixel block and its color fills whole block.
+        /// Block is traced by the tile that contains its top left pixel.
+        /// </summary>
+        void trace_tile_preview(Frame& frame, int level, const Cam::Camera& camera, const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, const Tile& tile)
+        {
+            size_t rays = 0;
+            const PathSettings settings = path_settings();
+            const uint64_t seed = Utils::mix_seed(_seed, ~uint64_t(level));
+            const Utils::SamplerType sampler_type = _sampler;
+            const auto wh = std::make_pair(frame.w(), frame.h());
+            auto first = [level](uint32_t v) { return (v + level - 1) / level * level; };
+
+            for (uint32_t y = first(tile.y0); y < tile.y1; y += level)
+            {
+                for (uint32_t x = first(tile.x0); x < tile.x1; x += level)
+                {
+                    const uint32_t x1 = std::min<uint32_t>(x + level, static_cast<uint32_t>(frame.w()));
+                    const uint32_t y1 = std::min<uint32_t>(y + level, static_cast<uint32_t>(frame.h()));
+
+                    Utils::Sampler sampler(sampler_type, seed, x, y, 0);
+                    const auto [u, v] = get_uv(float(x + (x1 - x) / 2), float(y + (y1 - y) / 2), wh, sampler);
+
+                    PrimaryHit primary;
+                    const glm::vec3 color = gen_color(camera.genray({ u, v }), world, materials, lights, sampler, settings, rays, &primary);
+                    const float l = Frame::luminance(color);
+
+                    for (uint32_t by = y; by < y1; by++)
+                    {
+                        for (uint32_t bx = x; bx < x1; bx++)
+                        {
+                            frame.accumulate(nullptr, bx, by, color, l * l, 1, primary.guide);
+                            frame.set_position(bx, by, primary.position);
+                        }
+                    }
+                }
+            }
+            _traced_rays += rays;
+        }
+
+        /// <summary>
+        /// Renders and publishes one preview iteration, picks level of the next one from its time
+        /// </summary>
+        void render_preview(thread_pool& pool, const Cam::Camera& camera, const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights)
+        {
+            using namespace std::chrono;
+            RT_TRACE_SCOPE("preview");
+            const auto start = high_resolution_clock::now();
+
+            Frame& frame = render_target.back_frame();
+            if (!scheduler.matches(frame.w(), frame.h(), _tile_size))
+                scheduler.configure(frame.w(), frame.h(), _tile_size);
+
+            const int level = _preview_level;
+            scheduler.run(pool, [&](const Tile& tile) { trace_tile_preview(frame, level, camera, world, materials, lights, tile); });
+
+            IterationStats stats;
+            stats.level = level;
+            stats.add(scheduler.worker_stats());
+
+            frame.samples = 0;
+            const auto publish_start = high_resolution_clock::now();
+            render_target.publish();
+            RT_TRACE_FLOW_BEGIN("frame", frame.epoch);
+            // preview is replaced, never accumulated on
+            render_target.restart();
+            stats.publish_ms = duration_cast<real_milliseconds>(high_resolution_clock::now() - publish_start).count();
+
+            const float ms = duration_cast<real_milliseconds>(high_resolution_clock::now() - start).count();
+            stats.finish(ms);
+            record(stats);
+            _preview_level = preview_level_for(ms * level * level, level / 2);
         }
 
         void render_loop()
         {
             using namespace std::chrono;
+            RT_TRACE_THREAD("render loop");
             thread_pool pool(_max_workers);
+            pool.sleep_duration = 50;
             //std::cout << "(render) Start" << std::endl;
             while (should_run)
             {
-                if (_iterations <= _max_iterations && (renderable_world.camera.has_value() && renderable_world.world.has_value()))
+                if (!is_done() && (renderable_world.camera.has_value() && renderable_world.world.has_value()))
                 {
                     const auto& camera = renderable_world.camera.value();
                     const auto& world = renderable_world.world.value();
+                    const auto& materials = renderable_world.materials.value().get();
+                    const auto& lights = renderable_world.lights.value().get();
 
+                    if (_preview_level > 1 && _preview_budget > 0.0f)
+                    {
+                        render_preview(pool, camera, world, materials, lights);
+                    }
+                    else
                     {
-                        //std::cout << "(render) Locking " << std::endl;
-                        GuardedRenderTarget::Surf recources = render_target.request_surface();   // Lock on render_target
-                        //std::cout << "(render) Locked" << std::endl;
+                        _preview_level = 1;
+                        RT_TRACE_SCOPE("iteration");
+
+                        // accumulate on top of last published epoch into free buffer, nobody waits for anybody
+                        Frame& frame = render_target.back_frame();
+                        const Frame* previous = render_target.last_published();
                         auto start = high_resolution_clock::now();
 
-                        pool.parallelize_loop(0, recources.raw.size(), [&](const int& a, const int& b) { trace_indexes(recources, 1, _max_bounces, camera, world, a, b); });
-                        pool.wait_for_tasks();
+                        if (!scheduler.matches(frame.w(), frame.h(), _tile_size))
+                            scheduler.configure(frame.w(), frame.h(), _tile_size);
+
+                        const int samples = samples_per_pixel(frame.w() * frame.h());
 
-                        auto end = high_resolution_clock::now();
+                        // with preview on, camera change abandons running iteration instead of waiting for it
+                        const bool can_abandon = _preview_budget > 0.0f;
+                        auto abandoned = [&]() { return can_abandon && _update_camera; };
+                        auto run = [&](const auto& trace)
+                        {
+                            scheduler.run(pool, [&](const Tile& tile)
+                                {
+                                    if (!abandoned())
+                                        trace(tile);
+                                });
+                        };
 
-                        _total_render_time += duration_cast<real_milliseconds>(end - start);
-                        _iterations += 1;
+                        if (_wavefront)
+                            run([&](const Tile& tile) { trace_tile_wavefront(frame, previous, samples, camera, world, materials, lights, tile); });
+                        else if (_packet_tracing && _max_bounces > 0)
+                            run([&](const Tile& tile) { trace_tile_packets(frame, previous, samples, camera, world, materials, lights, tile); });
+                        else
+                            run([&](const Tile& tile) { trace_tile(frame, previous, samples, camera, world, materials, lights, tile); });
 
-                        //std::cout << "(render) Unlocking" << std::endl;
-                        // render_target unlockned.
+                        if (abandoned())
+                        {
+                            _sampled_pixels = 0;
+                        }
+                        else
+                        {
+                            IterationStats stats;
+                            stats.add(scheduler.worker_stats());
+                            scheduler.refine();
+
+                            if (history != nullptr)
+                            {
+                                RT_TRACE_SCOPE("reproject");
+                                reproject(frame, *history, *history_camera, camera, pool);
+                                history = nullptr;
+                            }
+
+                            _active_pixels = _sampled_pixels.exchange(0);
+                            update_converged(frame, _noise_target);
+
+                            frame.samples = (previous ? previous->samples : 0) + 1;
+                            const auto publish_start = high_resolution_clock::now();
+                            render_target.publish();
+                            RT_TRACE_FLOW_BEGIN("frame", frame.epoch);
+
+                            auto end = high_resolution_clock::now();
+                            stats.publish_ms = duration_cast<real_milliseconds>(end - publish_start).count();
+                            stats.finish(duration_cast<real_milliseconds>(end - start).count());
+                            record(stats);
+
+                            full_iteration_ms = duration_cast<real_milliseconds>(end - start).count();
+                            _total_render_time += duration_cast<real_milliseconds>(end - start);
+                            _iteration_times.push_back(duration_cast<real_milliseconds>(end - start));
+                            _iterations += 1;
+                        }
                     }
                 }
                 else
@@ -163,17 +830,16 @@ namespace RT
                     std::this_thread::yield();
                 }
 
-                std::cout << std::boolalpha << _update_camera.load() << std::endl;
-
                 if (_update_camera)
                 {
-                    {
-                        //std::cout << "(render) Locking Camera" << std::endl;
-                        GuardedRenderTarget::Surf recources = render_target.request_surface(); // Lock on render_target
-                        reset_render_target(recources);
-                        //std::cout << "(render) Unlocking Camera" << std::endl;
-                        // render_target unlockned.
-                    }
+                    RT_TRACE_SCOPE("camera reset");
+                    // frame published last is not written until first iteration of new view is published,
+                    // preview iterations would publish over it
+                    const Frame* last = render_target.last_published();
+                    reset_render_target();
+                    history = _reprojection && _preview_level == 1 ? last : nullptr;
+                    if (history != nullptr)
+                        history_camera = renderable_world.camera;
                     if (new_camera.has_value()) {
                         renderable_world.camera = new_camera.value();
                         new_camera = std::nullopt;
@@ -184,14 +850,31 @@ namespace RT
             }
         }
 
-        void reset_render_target(GuardedRenderTarget::Surf& surf)
+        void record(const IterationStats& stats)
+        {
+            std::lock_guard<std::mutex> guard(stats_lock);
+            _stats.iterations.push_back(stats);
+        }
+
+        void reset_render_target()
         {
-            for (auto& px : surf.raw)
             {
-                px = { 0.0f, 0.0f, 0.0f };
+                std::lock_guard<std::mutex> guard(stats_lock);
+                _stats.iterations.clear();
             }
+            render_target.restart();
             _iterations = 0;
             _total_render_time = RT::real_milliseconds(0);
+            _iteration_times.clear();
+            _traced_rays = 0;
+            _active_pixels = 0;
+            _reprojected_pixels = 0;
+            _converged.clear();
+            // cost of full iteration is not known before first one, start from coarsest preview then
+            _preview_level = _preview_budget <= 0.0f ? 1
+                : full_iteration_ms <= 0.0f ? preview_max_level
+                : preview_level_for(full_iteration_ms, preview_max_level);
+            scheduler.configure(render_target.w(), render_target.h(), _tile_size);
         }
     };
 
@@ -5,13 +5,18 @@
 #include "../Primitives/Hittable.h"
 #include "../../Utils/VecStuff.h"
 #include "../../Utils/thread_pool.hpp"
+#include "../../Utils/Trace.h"
 #include <glm.hpp>
 #include <optional>
 #include <tuple>
 #include <iostream>
 #include <vector>
 #include <random>
+#include <chrono>
 #include "RTRenderer.h"
+#include "Resolve.h"
+#include "Denoise.h"
+#include "AOV.h"
 
 
 class RayTracer {
@@ -19,57 +24,123 @@ class RayTracer {
     Primitives::IHittable& world;
     Utils::SurfaceWrapper& pixels;
     
-    RT::GuardedRenderTarget& image;
+    RT::RenderTarget& image;
 
-    void update_surface(RT::GuardedRenderTarget::Surf& surf)
+    // frame currently on surface, valid until next `acquire`
+    const RT::Frame* shown = nullptr;
+    RT::Resolver resolver;
+    // resolve and AOV capture run on the window thread's own pool (denoiser has one of the same size), kept small so they do not compete with render workers
+    static constexpr uint32_t resolve_threads = 2;
+    thread_pool resolve_pool;
+
+    // filtered copy of `shown`, filtering whole frame is slow, so it runs in background and frame is submitted
+    // at most every `denoise_interval`. Raw frame is shown until first result arrives.
+    bool denoise = false;
+    RT::BackgroundDenoiser denoiser;
+    const RT::Frame* denoised = nullptr;
+    uint64_t submitted_epoch = 0;
+    std::chrono::steady_clock::time_point last_denoise;
+    static constexpr std::chrono::milliseconds denoise_interval{ 250 };
+
+    RT::AOVWriter aov_writer;
+
+    void update_surface(const RT::Frame& frame)
     {
-        float ratio = renderer.iterations();
-        for (int j = 0; j < pixels.h(); ++j)
+        RT_TRACE_SCOPE("resolve");
+        if (!denoise)
+        {
+            resolver.resolve(frame, pixels.data(), pixels.pitch(), resolve_pool);
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (frame.epoch > submitted_epoch && now - last_denoise >= denoise_interval && denoiser.submit(frame))
         {
-            for (int i = 0; i < pixels.w(); ++i)
-            {
-                pixels.setPixel(i, j, surf.get_pixel(i, j) / ratio);
-            }
+            submitted_epoch = frame.epoch;
+            last_denoise = now;
         }
+        if (const RT::Frame* result = denoiser.acquire())
+        {
+            // raw frame shown so far may be newer than the result, which would then look unchanged
+            if (denoised == nullptr)
+                resolver.invalidate();
+            denoised = result;
+        }
+        resolver.resolve(denoised != nullptr ? *denoised : frame, pixels.data(), pixels.pitch(), resolve_pool);
     }
 public:
 
     RT::RTRenderer renderer;
 
-    RayTracer(Utils::SurfaceWrapper& pixels, RT::GuardedRenderTarget& render_target, Primitives::IHittable& world, Cam::Camera camera, int _max_iters, int _max_bounces, int _max_workers = 8) :
+    RayTracer(Utils::SurfaceWrapper& pixels, RT::RenderTarget& render_target, Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, Cam::Camera camera, int _max_iters, int _max_bounces, int _max_workers = 8) :
         camera(camera),
         world(world),
         pixels(pixels),
+        image(render_target),
+        resolve_pool(resolve_threads),
+        denoiser(resolve_threads),
         renderer
         (
             render_target,
             _max_iters,
             _max_bounces,
             _max_workers
-        ),
-        image(render_target)
+        )
     {
-        renderer.request_world_update(world);
+        resolve_pool.sleep_duration = 50;
+        renderer.request_world_update(world, materials, lights);
         renderer.request_camera_update(camera);
     }
 
     void request_surface_update()
     {
-        //std::cout << "(window) Trying Locking" << std::endl;
-        std::optional<RT::GuardedRenderTarget::Surf> resource = image.request_asap_surface();
-
-        if (resource.has_value())
-        {
-            //std::cout << "(window) Locked " << std::endl;
-            auto surf = std::move(resource.value());
-
-            update_surface(surf);
-        }
-        else
+        RT_TRACE_SCOPE("surface update");
+        // Never blocks, only blocks changed since last resolve are redrawn
+        if (const RT::Frame* frame = image.acquire())
         {
-            //std::cout << "(window) Failed" << std::endl;
+            RT_TRACE_FLOW_END("frame", frame->epoch);
+            shown = frame;
         }
+        if (shown != nullptr)
+            update_surface(*shown);
+    }
+
+    /// <summary>
+    /// Exposure, gamma and tone mapping of displayed image, whole surface is redrawn on next update
+    /// </summary>
+    void request_display_settings(const RT::DisplaySettings& settings)
+    {
+        resolver.configure(settings);
+    }
+
+    /// <summary>
+    /// Shows output of the denoiser instead of raw accumulated frame, whole surface is redrawn on next update
+    /// </summary>
+    void request_denoise(bool enabled)
+    {
+        denoise = enabled;
+        denoiser.discard();
+        denoised = nullptr;
+        submitted_epoch = 0;
+        resolver.invalidate();
+    }
+
+    bool is_denoising() const { return denoise; }
+
+    /// <summary>
+    /// Saves every AOV of displayed frame into `path` (.exr or .pfm). Only copying the frame happens here,
+    /// file is written in background. Returns false if nothing is displayed yet or format is unknown.
+    /// </summary>
+    bool request_snapshot(const std::string& path)
+    {
+        const auto format = RT::image_format(path);
+        if (shown == nullptr || !format.has_value())
+            return false;
 
+        RT::AOVBuffer aovs(RT::all_aovs, shown->w(), shown->h());
+        aovs.capture(*shown, resolve_pool);
+        aov_writer.submit(std::move(aovs), path, *format);
+        return true;
     }
 
     void request_camera_update(Cam::Camera new_cam)
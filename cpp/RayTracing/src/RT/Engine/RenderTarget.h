@@ -0,0 +1,280 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm.hpp>
+#include <vector>
+
+namespace RT
+{
+    /// <summary>
+    /// Auxiliary features of first surface hit by camera ray, guide the denoiser.
+    /// Sky has zero normal and depth.
+    /// </summary>
+    struct Guide
+    {
+        glm::vec3 albedo = glm::vec3(0.0f);
+        // facing the camera
+        glm::vec3 normal = glm::vec3(0.0f);
+        // distance from camera
+        float depth = 0.0f;
+
+        Guide& operator+=(const Guide& other)
+        {
+            albedo += other.albedo;
+            normal += other.normal;
+            depth += other.depth;
+            return *this;
+        }
+
+        Guide operator*(float s) const
+        {
+            return { albedo * s, normal * s, depth * s };
+        }
+    };
+
+    /// <summary>
+    /// One accumulation epoch - sum of samples for every pixel. `samples` is number of iterations,
+    /// pixels converged under adaptive sampling stop early so each keeps its own count.
+    /// </summary>
+    struct Frame
+    {
+        std::vector<glm::vec3> raw;
+        // sum of squared sample luminance, for variance estimate
+        std::vector<float> raw_sq;
+        std::vector<uint32_t> counts;
+        // primary hit of the latest sample (see `PrimaryHit`), used by temporal reprojection
+        std::vector<glm::vec4> position;
+        // sum of guides of all samples, averaged by `counts` like `raw`
+        std::vector<Guide> guide;
+        // epoch in which any pixel of `block_size` x `block_size` block changed last time
+        std::vector<uint64_t> block_epoch;
+        size_t img_w = 0;
+        int samples = 0;
+        uint64_t epoch = 0;
+
+        glm::vec3& get_pixel(size_t x, size_t y)
+        {
+            return raw[x + img_w * y];
+        }
+
+        const glm::vec3& get_pixel(size_t x, size_t y) const
+        {
+            return raw[x + img_w * y];
+        }
+
+        uint32_t get_count(size_t x, size_t y) const
+        {
+            return counts[x + img_w * y];
+        }
+
+        /// <summary>
+        /// Average of pixel samples
+        /// </summary>
+        glm::vec3 mean(size_t x, size_t y) const
+        {
+            const size_t i = x + img_w * y;
+            return counts[i] == 0 ? glm::vec3(0.0f) : raw[i] / static_cast<float>(counts[i]);
+        }
+
+        /// <summary>
+        /// Average guide of pixel samples, normal is not renormalized
+        /// </summary>
+        Guide mean_guide(size_t x, size_t y) const
+        {
+            const size_t i = x + img_w * y;
+            return counts[i] == 0 ? Guide() : guide[i] * (1.0f / counts[i]);
+        }
+
+        /// <summary>
+        /// Stores `previous` pixel plus `n` new samples with sum `color`, sum of squared luminances `sq`
+        /// and sum of guides `g`.
+        /// </summary>
+        void accumulate(const Frame* previous, size_t x, size_t y, const glm::vec3& color, float sq, uint32_t n, const Guide& g)
+        {
+            const size_t i = x + img_w * y;
+            if (previous)
+            {
+                raw[i] = previous->raw[i] + color;
+                raw_sq[i] = previous->raw_sq[i] + sq;
+                counts[i] = previous->counts[i] + n;
+                guide[i] = previous->guide[i];
+                guide[i] += g;
+                // sampled pixels set their own
+                if (n == 0)
+                    position[i] = previous->position[i];
+            }
+            else
+            {
+                raw[i] = color;
+                raw_sq[i] = sq;
+                counts[i] = n;
+                guide[i] = g;
+            }
+        }
+
+        void set_position(size_t x, size_t y, const glm::vec4& p)
+        {
+            position[x + img_w * y] = p;
+        }
+
+        /// <summary>
+        /// Standard error of mean pixel luminance normalized by square root of the mean, so dark pixels are not
+        /// held to stricter target than perceptually similar bright ones (0 if pixel has less than 2 samples).
+        /// </summary>
+        float relative_error(size_t x, size_t y) const
+        {
+            const size_t i = x + img_w * y;
+            const float n = static_cast<float>(counts[i]);
+            if (n < 2.0f)
+                return 0.0f;
+
+            const float mean = luminance(raw[i]) / n;
+            const float variance = std::max(0.0f, raw_sq[i] / n - mean * mean) * n / (n - 1.0f);
+            return std::sqrt(variance / n) / std::sqrt(mean + 1e-3f);
+        }
+
+        size_t w() const { return img_w; }
+        size_t h() const { return img_w == 0 ? 0 : raw.size() / img_w; }
+
+        static constexpr size_t block_size = 32;
+
+        size_t blocks_x() const { return (w() + block_size - 1) / block_size; }
+        size_t blocks_y() const { return (h() + block_size - 1) / block_size; }
+
+        /// <summary>
+        /// Stamps blocks whose sample counts differ from `previous` with current epoch, others keep stamp of `previous`.
+        /// Without `previous` every block is new.
+        /// </summary>
+        void stamp_blocks(const Frame* previous)
+        {
+            for (size_t by = 0; by < blocks_y(); by++)
+            {
+                for (size_t bx = 0; bx < blocks_x(); bx++)
+                {
+                    const size_t b = bx + by * blocks_x();
+                    block_epoch[b] = previous && !block_changed(*previous, bx, by) ? previous->block_epoch[b] : epoch;
+                }
+            }
+        }
+
+        static float luminance(const glm::vec3& c)
+        {
+            return 0.2126f * c.r + 0.7152f * c.g + 0.0722f * c.b;
+        }
+
+    private:
+        // pixel changes only by taking samples, so comparing counts is enough
+        bool block_changed(const Frame& previous, size_t bx, size_t by) const
+        {
+            const size_t x1 = std::min(w(), (bx + 1) * block_size);
+            const size_t y1 = std::min(h(), (by + 1) * block_size);
+            for (size_t y = by * block_size; y < y1; y++)
+            {
+                const size_t row = y * img_w;
+                for (size_t x = bx * block_size; x < x1; x++)
+                {
+                    if (counts[row + x] != previous.counts[row + x])
+                        return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    /// <summary>
+    /// Lock-free triple buffer between render thread (single writer) and window thread (single reader).
+    /// Writer fills `back`, `publish` swaps it with the shared middle slot; reader swaps middle with its
+    /// `front` only if it holds something newer. Neither side ever waits for the other.
+    ///
+    /// Writer accumulates on top of the frame it published last (`last_published`). That frame is either
+    /// in middle slot or in reader's hands, both sides only read it, so it is never written concurrently.
+    /// </summary>
+    class RenderTarget
+    {
+        static constexpr uint32_t index_mask = 0b011;
+        static constexpr uint32_t fresh_bit = 0b100;
+
+        Frame frames[3];
+
+        // shared slot: index of middle frame + fresh_bit if reader has not seen it yet
+        alignas(64) std::atomic<uint32_t> middle;
+
+        // writer side
+        alignas(64) uint32_t back = 0;
+        int last = -1;
+        uint64_t epoch = 0;
+
+        // reader side
+        alignas(64) uint32_t front = 2;
+
+    public:
+        RenderTarget(size_t img_w, size_t img_h) : middle(1)
+        {
+            for (auto& frame : frames)
+            {
+                frame.raw.assign(img_w * img_h, glm::vec3(0.0f));
+                frame.raw_sq.assign(img_w * img_h, 0.0f);
+                frame.counts.assign(img_w * img_h, 0);
+                frame.position.assign(img_w * img_h, glm::vec4(0.0f));
+                frame.guide.assign(img_w * img_h, Guide());
+                frame.img_w = img_w;
+                frame.block_epoch.assign(frame.blocks_x() * frame.blocks_y(), 0);
+            }
+        }
+
+        RenderTarget(const RenderTarget&) = delete;
+        RenderTarget& operator=(const RenderTarget&) = delete;
+
+        size_t w() const { return frames[0].w(); }
+        size_t h() const { return frames[0].h(); }
+
+        // ==== writer (render thread) ====
+
+        Frame& back_frame()
+        {
+            return frames[back];
+        }
+
+        /// <summary>
+        /// Frame published most recently by the writer, or nullptr after `restart`
+        /// </summary>
+        const Frame* last_published() const
+        {
+            return last < 0 ? nullptr : &frames[last];
+        }
+
+        /// <summary>
+        /// Next epoch will not accumulate on top of previous ones (eg. camera moved)
+        /// </summary>
+        void restart()
+        {
+            last = -1;
+        }
+
+        void publish()
+        {
+            frames[back].epoch = ++epoch;
+            frames[back].stamp_blocks(last_published());
+            last = static_cast<int>(back);
+            back = middle.exchange(back | fresh_bit, std::memory_order_acq_rel) & index_mask;
+        }
+
+        // ==== reader (window thread) ====
+
+        /// <summary>
+        /// Returns newest published frame, or nullptr if nothing was published since last call.
+        /// Returned frame stays valid and unchanged until next `acquire`.
+        /// </summary>
+        const Frame* acquire()
+        {
+            if ((middle.load(std::memory_order_relaxed) & fresh_bit) == 0)
+                return nullptr;
+
+            front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+            return &frames[front];
+        }
+    };
+}
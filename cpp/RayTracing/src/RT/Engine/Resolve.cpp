@@ -0,0 +1,142 @@
+#include "Resolve.h"
+#include <cmath>
+#include <algorithm>
+#include "../../Utils/Simd.h"
+#include "../../Utils/Trace.h"
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Resolve reads accumulation buffer as packed floats.");
+
+namespace
+{
+    // little endian BGRA, same layout as Utils::SurfaceWrapper::Pixel
+    uint32_t pack(uint8_t r, uint8_t g, uint8_t b)
+    {
+        return uint32_t(b) | uint32_t(g) << 8 | uint32_t(r) << 16 | 0xFF000000u;
+    }
+}
+
+void RT::Resolver::configure(const DisplaySettings& new_settings)
+{
+    settings = new_settings;
+    const float gamma = settings.gamma > 0.0f ? settings.gamma : 1.0f;
+    const float top = static_cast<float>(lut.size() - 1);
+
+    for (size_t i = 0; i < lut.size(); i++)
+    {
+        const float root = i / top;
+        lut[i] = static_cast<uint8_t>(std::lround(255.0f * std::pow(root * root, 1.0f / gamma)));
+    }
+
+    invalidate();
+}
+
+void RT::Resolver::resolve_row(const glm::vec3* raw, const uint32_t* counts, size_t count, uint32_t* out) const
+{
+    using Utils::float4;
+
+    const float top = static_cast<float>(lut.size() - 1);
+    const bool reinhard = settings.tonemap == ToneMap::Reinhard;
+
+    // NaN turns into 0 in max (and inf into 1 in min), both return second operand for NaN.
+    // Approximate reciprocals are precise enough for 12 bit table index and much cheaper than div / sqrt.
+    auto map = [&](float4 v)
+    {
+        v = Utils::max(v, float4(0.0f));
+        if (reinhard)
+            v = v * Utils::rcp(float4(1.0f) + v);
+        v = Utils::min(v, float4(1.0f));
+        // sqrt(v) = v / sqrt(v), tiny bias keeps 0 away from 0 * inf
+        v = v + float4(1e-12f);
+        return Utils::min(v * Utils::rsqrt(v), float4(1.0f)) * float4(top) + float4(0.5f);
+    };
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const float4 n(float(counts[i]), float(counts[i + 1]), float(counts[i + 2]), float(counts[i + 3]));
+        const float4 inv = Utils::select(n > float4(0.0f), float4(settings.exposure) / Utils::max(n, float4(1.0f)), float4(0.0f));
+
+        alignas(16) float s[4];
+        inv.store(s);
+
+        // 4 pixels = 12 interleaved channels
+        const float* src = &raw[i].x;
+        alignas(16) int32_t index[12];
+        Utils::store_int(map(float4::loadu(src) * float4(s[0], s[0], s[0], s[1])), index);
+        Utils::store_int(map(float4::loadu(src + 4) * float4(s[1], s[1], s[2], s[2])), index + 4);
+        Utils::store_int(map(float4::loadu(src + 8) * float4(s[2], s[3], s[3], s[3])), index + 8);
+
+        for (size_t p = 0; p < 4; p++)
+            out[i + p] = pack(lut[index[3 * p]], lut[index[3 * p + 1]], lut[index[3 * p + 2]]);
+    }
+
+    for (; i < count; i++)
+    {
+        const float s = counts[i] == 0 ? 0.0f : settings.exposure / counts[i];
+        alignas(16) int32_t index[4];
+        Utils::store_int(map(float4(raw[i].r * s, raw[i].g * s, raw[i].b * s, 0.0f)), index);
+        out[i] = pack(lut[index[0]], lut[index[1]], lut[index[2]]);
+    }
+}
+
+void RT::Resolver::resolve_block_row(const Frame& frame, size_t by, uint32_t* pixels, size_t pitch) const
+{
+    const size_t blocks_x = frame.blocks_x();
+    const size_t y1 = std::min(frame.h(), (by + 1) * Frame::block_size);
+
+    // runs of neighbouring dirty blocks are converted row by row, so memory is read in long streams
+    for (size_t bx = 0; bx < blocks_x;)
+    {
+        if (!dirty[bx + by * blocks_x])
+        {
+            bx++;
+            continue;
+        }
+
+        const size_t x0 = bx * Frame::block_size;
+        while (bx < blocks_x && dirty[bx + by * blocks_x])
+            bx++;
+        const size_t x1 = std::min(frame.w(), bx * Frame::block_size);
+
+        for (size_t y = by * Frame::block_size; y < y1; y++)
+        {
+            const size_t row = y * frame.w();
+            resolve_row(&frame.raw[row + x0], &frame.counts[row + x0], x1 - x0, pixels + y * pitch + x0);
+        }
+    }
+}
+
+size_t RT::Resolver::resolve(const Frame& frame, uint32_t* pixels, size_t pitch, thread_pool& pool)
+{
+    if (frame.epoch <= resolved_epoch)
+        return 0;
+
+    const size_t blocks_x = frame.blocks_x();
+    size_t count = 0;
+
+    dirty.resize(frame.block_epoch.size());
+    rows.clear();
+    for (size_t by = 0; by < frame.blocks_y(); by++)
+    {
+        bool any = false;
+        for (size_t bx = 0; bx < blocks_x; bx++)
+        {
+            const size_t b = bx + by * blocks_x;
+            dirty[b] = frame.block_epoch[b] > resolved_epoch;
+            any |= dirty[b] != 0;
+            count += dirty[b];
+        }
+        if (any)
+            rows.push_back(static_cast<uint32_t>(by));
+    }
+
+    pool.parallelize_loop(size_t(0), rows.size(), [&](size_t begin, size_t end)
+        {
+            RT_TRACE_SCOPE("resolve rows");
+            for (size_t i = begin; i < end; i++)
+                resolve_block_row(frame, rows[i], pixels, pitch);
+        });
+
+    resolved_epoch = frame.epoch;
+    return count;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <glm.hpp>
+
+#include "../../Utils/thread_pool.hpp"
+#include "RenderTarget.h"
+
+namespace RT
+{
+    enum class ToneMap
+    {
+        Clamp,
+        Reinhard,
+    };
+
+    struct DisplaySettings
+    {
+        // multiplies mean radiance before tone mapping
+        float exposure = 1.0f;
+        // 1 keeps linear output
+        float gamma = 1.0f;
+        ToneMap tonemap = ToneMap::Clamp;
+    };
+
+    /// <summary>
+    /// Converts accumulated frame into 32 bit BGRA pixels for display. Four pixels are scaled by their sample count,
+    /// tone mapped and clamped at once, gamma is applied by lookup table indexed by square root of the value
+    /// (so dark values, where gamma curve is steep, get most of the entries).
+    /// Only blocks stamped after last resolved epoch are converted, rows of blocks are spread over thread pool.
+    /// </summary>
+    class Resolver
+    {
+        std::array<uint8_t, 4096> lut;
+        DisplaySettings settings;
+        uint64_t resolved_epoch = 0;
+        // per block flag and rows of blocks with at least one flag set, rebuilt by every `resolve`
+        std::vector<uint8_t> dirty;
+        std::vector<uint32_t> rows;
+
+        void resolve_block_row(const Frame& frame, size_t by, uint32_t* pixels, size_t pitch) const;
+
+    public:
+        Resolver() { configure({}); }
+
+        /// <summary>
+        /// Rebuilds lookup table, next `resolve` converts whole frame
+        /// </summary>
+        void configure(const DisplaySettings& new_settings);
+
+        const DisplaySettings& get_settings() const { return settings; }
+
+        /// <summary>
+        /// Forces next `resolve` to convert whole frame (eg. target surface was overwritten)
+        /// </summary>
+        void invalidate() { resolved_epoch = 0; }
+
+        /// <summary>
+        /// Writes blocks of `frame` changed since last call into `pixels` (row length `pitch` pixels).
+        /// Returns number of converted blocks.
+        /// </summary>
+        size_t resolve(const Frame& frame, uint32_t* pixels, size_t pitch, thread_pool& pool);
+
+        /// <summary>
+        /// Converts `count` pixels of one row, `raw` and `counts` are accumulated sums and sample counts.
+        /// </summary>
+        void resolve_row(const glm::vec3* raw, const uint32_t* counts, size_t count, uint32_t* out) const;
+    };
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "../../Utils/Counters.h"
+#include "TileScheduler.h"
+
+namespace RT
+{
+    /// <summary>
+    /// Counters and worker times of one published iteration, summed over all workers
+    /// </summary>
+    struct IterationStats
+    {
+        // side of pixel block traced by one sample, 1 for full resolution iteration (see `request_preview`)
+        int level = 1;
+        uint32_t workers = 0;
+        uint32_t tiles = 0;
+        uint32_t steals = 0;
+
+        // wall time of the iteration from start of tracing to publish
+        float wall_ms = 0.0f;
+        // worker times, together they add up to `workers` * `wall_ms`
+        float busy_ms = 0.0f;
+        float schedule_ms = 0.0f;
+        float idle_ms = 0.0f;
+        // part of `schedule_ms` spent waiting for tile queue locked by other worker
+        float lock_wait_ms = 0.0f;
+        // render thread handing frame over to readers
+        float publish_ms = 0.0f;
+
+        Utils::Counters counters;
+
+        /// <summary>
+        /// Sums worker statistics of one `TileScheduler::run`
+        /// </summary>
+        void add(const std::vector<WorkerStats>& stats)
+        {
+            workers = std::max(workers, static_cast<uint32_t>(stats.size()));
+            for (const WorkerStats& worker : stats)
+            {
+                counters += worker.counters;
+                busy_ms += worker.busy_ms;
+                schedule_ms += worker.schedule_ms;
+                lock_wait_ms += worker.lock_wait_ms;
+                tiles += worker.tiles;
+                steals += worker.steals;
+            }
+        }
+
+        /// <summary>
+        /// Closes iteration that took `wall` ms, the rest of worker time is idle
+        /// </summary>
+        void finish(float wall)
+        {
+            wall_ms = wall;
+            idle_ms = std::max(0.0f, workers * wall_ms - busy_ms - schedule_ms);
+        }
+
+        IterationStats& operator+=(const IterationStats& other)
+        {
+            level = std::min(level, other.level);
+            workers = std::max(workers, other.workers);
+            tiles += other.tiles;
+            steals += other.steals;
+            wall_ms += other.wall_ms;
+            busy_ms += other.busy_ms;
+            schedule_ms += other.schedule_ms;
+            idle_ms += other.idle_ms;
+            lock_wait_ms += other.lock_wait_ms;
+            publish_ms += other.publish_ms;
+            counters += other.counters;
+            return *this;
+        }
+
+        double escaped_ratio() const
+        {
+            return counters.paths == 0 ? 0.0 : static_cast<double>(counters.escaped) / counters.paths;
+        }
+
+        double busy_ratio() const
+        {
+            const double total = static_cast<double>(workers) * wall_ms;
+            return total <= 0.0 ? 0.0 : busy_ms / total;
+        }
+    };
+
+    /// <summary>
+    /// Snapshot of render statistics since last camera change
+    /// </summary>
+    struct RenderStats
+    {
+        std::vector<IterationStats> iterations;
+
+        IterationStats total() const
+        {
+            IterationStats sum;
+            for (const IterationStats& iteration : iterations)
+                sum += iteration;
+            return sum;
+        }
+    };
+}
@@ -0,0 +1,310 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include "../../Utils/thread_pool.hpp"
+#include "../../Utils/Counters.h"
+#include "../../Utils/Trace.h"
+
+namespace RT
+{
+    struct Tile
+    {
+        uint32_t x0, y0; // inclusive
+        uint32_t x1, y1; // exclusive
+
+        uint32_t w() const { return x1 - x0; }
+        uint32_t h() const { return y1 - y0; }
+    };
+
+    struct TileCost
+    {
+        Tile tile;
+        float ms;
+    };
+
+    /// <summary>
+    /// What one worker did during `TileScheduler::run`
+    /// </summary>
+    struct alignas(64) WorkerStats
+    {
+        // events counted by tiles traced on the worker
+        Utils::Counters counters;
+        float busy_ms = 0.0f;
+        // taking tiles from queues, including `lock_wait_ms` spent waiting for queue held by other worker
+        float schedule_ms = 0.0f;
+        float lock_wait_ms = 0.0f;
+        uint32_t tiles = 0;
+        uint32_t steals = 0;
+    };
+
+    /// <summary>
+    /// Splits framebuffer into square tiles in Morton order and renders them with work stealing.
+    /// Every worker owns contiguous (so spatially coherent) run of tiles, takes them from the front
+    /// of its queue and steals from the back of others when it runs dry.
+    /// Tile cost from last iteration is kept, `refine` splits tiles that are much more expensive than average.
+    /// </summary>
+    class TileScheduler
+    {
+        struct alignas(64) WorkQueue
+        {
+            std::mutex m;
+            std::deque<uint32_t> tiles;
+        };
+
+        size_t img_w = 0;
+        size_t img_h = 0;
+        uint32_t tile_size = 0;
+
+        std::vector<Tile> tiles;
+        std::vector<float> costs;
+
+        std::unique_ptr<WorkQueue[]> queues;
+        uint32_t queue_count = 0;
+        std::vector<WorkerStats> stats;
+
+        static uint32_t morton(uint32_t x, uint32_t y)
+        {
+            auto spread = [](uint32_t v)
+            {
+                v &= 0x0000FFFF;
+                v = (v | (v << 8)) & 0x00FF00FF;
+                v = (v | (v << 4)) & 0x0F0F0F0F;
+                v = (v | (v << 2)) & 0x33333333;
+                v = (v | (v << 1)) & 0x55555555;
+                return v;
+            };
+            return spread(x) | (spread(y) << 1);
+        }
+
+        // lock is tried first, so uncontended case does not read the clock
+        static std::unique_lock<std::mutex> lock_queue(WorkQueue& queue, float& wait_ms)
+        {
+            std::unique_lock<std::mutex> lk(queue.m, std::try_to_lock);
+            if (!lk.owns_lock())
+            {
+                const auto start = std::chrono::steady_clock::now();
+                lk.lock();
+                wait_ms += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+            return lk;
+        }
+
+        bool pop_own(uint32_t worker, uint32_t& tile)
+        {
+            const auto lk = lock_queue(queues[worker], stats[worker].lock_wait_ms);
+            if (queues[worker].tiles.empty())
+                return false;
+            tile = queues[worker].tiles.front();
+            queues[worker].tiles.pop_front();
+            return true;
+        }
+
+        bool steal(uint32_t thief, uint32_t& tile)
+        {
+            for (uint32_t i = 1; i < queue_count; i++)
+            {
+                WorkQueue& victim = queues[(thief + i) % queue_count];
+                const auto lk = lock_queue(victim, stats[thief].lock_wait_ms);
+                if (!victim.tiles.empty())
+                {
+                    tile = victim.tiles.back();
+                    victim.tiles.pop_back();
+                    stats[thief].steals += 1;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    public:
+        static constexpr uint32_t min_tile_size = 4;
+        // tile is split into quadrants if it took this many times longer than average tile
+        static constexpr float split_factor = 4.0f;
+        // upper bound for tile count after refinements, relative to initial grid
+        static constexpr size_t max_tile_growth = 4;
+
+        bool matches(size_t w, size_t h, uint32_t size) const
+        {
+            return img_w == w && img_h == h && tile_size == size;
+        }
+
+        /// <summary>
+        /// Rebuilds uniform grid of `size` x `size` tiles and forgets collected costs
+        /// </summary>
+        void configure(size_t w, size_t h, uint32_t size)
+        {
+            img_w = w;
+            img_h = h;
+            tile_size = std::max(size, min_tile_size);
+
+            const uint32_t tiles_x = static_cast<uint32_t>((w + tile_size - 1) / tile_size);
+            const uint32_t tiles_y = static_cast<uint32_t>((h + tile_size - 1) / tile_size);
+
+            std::vector<std::pair<uint32_t, Tile>> ordered;
+            ordered.reserve(size_t(tiles_x) * tiles_y);
+            for (uint32_t ty = 0; ty < tiles_y; ty++)
+            {
+                for (uint32_t tx = 0; tx < tiles_x; tx++)
+                {
+                    const Tile tile = {
+                        tx * tile_size,
+                        ty * tile_size,
+                        std::min(static_cast<uint32_t>(w), (tx + 1) * tile_size),
+                        std::min(static_cast<uint32_t>(h), (ty + 1) * tile_size)
+                    };
+                    ordered.push_back({ morton(tx, ty), tile });
+                }
+            }
+
+            std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+            tiles.clear();
+            for (const auto& [code, tile] : ordered)
+                tiles.push_back(tile);
+
+            costs.assign(tiles.size(), 0.0f);
+        }
+
+        /// <summary>
+        /// Renders every tile once, `trace` is called as trace(const Tile&) from pool workers.
+        /// Blocks until all tiles are done.
+        /// </summary>
+        template <typename F>
+        void run(thread_pool& pool, const F& trace)
+        {
+            const uint32_t workers = std::max<uint32_t>(1, pool.get_thread_count());
+            if (queue_count != workers)
+            {
+                queues = std::make_unique<WorkQueue[]>(workers);
+                queue_count = workers;
+            }
+            stats.assign(workers, WorkerStats());
+
+            const size_t count = tiles.size();
+            for (uint32_t k = 0; k < workers; k++)
+            {
+                auto& q = queues[k].tiles;
+                q.clear();
+                for (size_t i = count * k / workers; i < count * (k + 1) / workers; i++)
+                    q.push_back(static_cast<uint32_t>(i));
+            }
+
+            for (uint32_t k = 0; k < workers; k++)
+            {
+                pool.push_task([this, k, &trace]()
+                    {
+                        using namespace std::chrono;
+                        RT_TRACE_THREAD("worker");
+                        RT_TRACE_SCOPE("tiles");
+                        WorkerStats& own = stats[k];
+                        const Utils::Counters before = Utils::thread_counters;
+                        uint32_t index;
+                        auto start = steady_clock::now();
+                        while (true)
+                        {
+                            const bool found = pop_own(k, index) || steal(k, index);
+                            const auto taken = steady_clock::now();
+                            own.schedule_ms += duration<float, std::milli>(taken - start).count();
+                            if (!found)
+                                break;
+
+                            {
+                                RT_TRACE_SCOPE("tile");
+                                trace(tiles[index]);
+                            }
+                            start = steady_clock::now();
+                            costs[index] = duration<float, std::milli>(start - taken).count();
+                            own.busy_ms += costs[index];
+                            own.tiles += 1;
+                        }
+                        own.counters = Utils::thread_counters - before;
+                    });
+            }
+            pool.wait_for_tasks();
+        }
+
+        /// <summary>
+        /// Splits tiles that cost more than `split_factor` times the average into quadrants.
+        /// Quadrants are inserted in place (in Z order), so overall Morton ordering is kept.
+        /// </summary>
+        void refine()
+        {
+            if (tiles.empty())
+                return;
+
+            float total = 0.0f;
+            for (float c : costs)
+                total += c;
+            const float threshold = split_factor * total / tiles.size();
+
+            const size_t grid = ((img_w + tile_size - 1) / tile_size) * ((img_h + tile_size - 1) / tile_size);
+            const size_t limit = grid * max_tile_growth;
+
+            std::vector<Tile> refined;
+            std::vector<float> refined_costs;
+            refined.reserve(tiles.size());
+            refined_costs.reserve(tiles.size());
+
+            for (size_t i = 0; i < tiles.size(); i++)
+            {
+                const Tile& t = tiles[i];
+                const bool can_split = t.w() >= 2 * min_tile_size && t.h() >= 2 * min_tile_size;
+
+                if (costs[i] > threshold && can_split && refined.size() + (tiles.size() - i) + 3 <= limit)
+                {
+                    const uint32_t mx = t.x0 + t.w() / 2;
+                    const uint32_t my = t.y0 + t.h() / 2;
+                    const Tile quads[4] = {
+                        { t.x0, t.y0, mx, my },
+                        { mx, t.y0, t.x1, my },
+                        { t.x0, my, mx, t.y1 },
+                        { mx, my, t.x1, t.y1 },
+                    };
+                    for (const auto& q : quads)
+                    {
+                        refined.push_back(q);
+                        refined_costs.push_back(costs[i] / 4.0f);
+                    }
+                }
+                else
+                {
+                    refined.push_back(t);
+                    refined_costs.push_back(costs[i]);
+                }
+            }
+
+            tiles = std::move(refined);
+            costs = std::move(refined_costs);
+        }
+
+        /// <summary>
+        /// Tiles with time they took in last iteration
+        /// </summary>
+        std::vector<TileCost> tile_costs() const
+        {
+            std::vector<TileCost> result;
+            result.reserve(tiles.size());
+            for (size_t i = 0; i < tiles.size(); i++)
+                result.push_back({ tiles[i], costs[i] });
+            return result;
+        }
+
+        /// <summary>
+        /// What every worker did during last `run`
+        /// </summary>
+        const std::vector<WorkerStats>& worker_stats() const
+        {
+            return stats;
+        }
+
+        size_t tile_count() const
+        {
+            return tiles.size();
+        }
+    };
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include <glm.hpp>
+
+#include "../../Utils/Sampler.h"
+#include "../Camera/Ray.h"
+#include "../Primitives/Hittable.h"
+#include "shade.h"
+#include "TileScheduler.h"
+
+namespace RT
+{
+    /// <summary>
+    /// Wavefront path tracer. Instead of following one path to the end it keeps every path of a tile
+    /// in SoA buffers and advances all of them stage by stage:
+    /// generate -> (extend -> sort by material -> shade)* -> accumulate.
+    /// Every path owns its sampler and consumes it in the same order as `gen_color`, so result
+    /// matches megakernel path exactly. Buffers are reused between calls, keep one instance per thread.
+    /// </summary>
+    class Wavefront
+    {
+        // path state, indexed by path id (= pixel index within tile)
+        std::vector<float> ox, oy, oz;
+        std::vector<float> dx, dy, dz;
+        std::vector<glm::vec3> throughput;
+        std::vector<glm::vec3> radiance;
+        // vertex that chose current ray and `scatter_pdf` of the choice, see `emitted`
+        std::vector<glm::vec3> from;
+        std::vector<float> from_pdf;
+        std::vector<Utils::Sampler> samplers;
+        std::vector<std::optional<Primitives::Record>> hits;
+        std::vector<PrimaryHit> primary;
+        std::vector<char> sampled;
+
+        // ids of paths still alive and of paths waiting for shading, sorted by material
+        std::vector<uint32_t> active;
+        // (material type << 32 | material handle, path)
+        std::vector<std::pair<uint64_t, uint32_t>> shade_queue;
+
+        ray get_ray(uint32_t path) const
+        {
+            return ray({ ox[path], oy[path], oz[path] }, { dx[path], dy[path], dz[path] });
+        }
+
+        void set_ray(uint32_t path, const ray& r)
+        {
+            ox[path] = r.origin.x; oy[path] = r.origin.y; oz[path] = r.origin.z;
+            dx[path] = r.dir.x; dy[path] = r.dir.y; dz[path] = r.dir.z;
+        }
+
+        void resize(size_t count)
+        {
+            for (auto* v : { &ox, &oy, &oz, &dx, &dy, &dz })
+                v->resize(count);
+            throughput.resize(count);
+            radiance.resize(count);
+            from.resize(count);
+            from_pdf.resize(count);
+            samplers.resize(count, Utils::Sampler(Utils::SamplerType::Random, 0, 0, 0, 0));
+            hits.resize(count);
+            primary.resize(count);
+            active.reserve(count);
+            shade_queue.reserve(count);
+        }
+
+        // intersects every active path, misses gather sky and leave, hits are queued for shading
+        void extend(const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, int bounce, size_t& rays)
+        {
+            Utils::Counters& counters = Utils::thread_counters;
+            shade_queue.clear();
+            for (uint32_t path : active)
+            {
+                rays += 1;
+                if (bounce == 0)
+                    counters.primary_rays += 1;
+                else
+                    counters.secondary_rays += 1;
+                auto& hit = hits[path];
+                hit = world.intersect(get_ray(path), 0.001f, std::numeric_limits<float>::infinity());
+                if (bounce == 0)
+                    primary[path] = primary_hit(get_ray(path), hit ? &*hit : nullptr, materials);
+
+                if (!hit.has_value())
+                {
+                    radiance[path] += throughput[path] * sky(get_ray(path));
+                    counters.end_path(bounce, true);
+                    continue;
+                }
+                const Mat::Material& mat = materials[hit->mat];
+                if (mat.type == Mat::Type::Emissive)
+                {
+                    radiance[path] += throughput[path] * emitted(mat, *hit, lights, from[path], from_pdf[path]);
+                    counters.end_path(bounce, false);
+                    continue;
+                }
+                if (bounce >= mat.max_bounces)
+                {
+                    counters.end_path(bounce, false);
+                    continue;
+                }
+
+                // same material type first, same material second
+                shade_queue.push_back({ uint64_t(mat.type) << 32 | hit->mat, path });
+            }
+
+            std::sort(shade_queue.begin(), shade_queue.end());
+        }
+
+        void shade(const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, int bounce, const PathSettings& settings, size_t& rays)
+        {
+            Utils::Counters& counters = Utils::thread_counters;
+            const bool next_event = settings.next_event && !lights.empty();
+            active.clear();
+            for (const auto& [key, path] : shade_queue)
+            {
+                const auto& hit = *hits[path];
+                const Mat::Material& mat = materials[hit.mat];
+                const ray in = get_ray(path);
+
+                if (next_event && samples_lights(mat) && bounce + 1 < settings.max_bounces)
+                    radiance[path] += throughput[path] * direct_light(mat, hit, bounce, world, lights, samplers[path], rays);
+
+                glm::vec3 att;
+                ray out({}, {});
+                samplers[path].start_bounce(bounce);
+                if (!mat.scatter(in, hit, att, out, samplers[path]))
+                {
+                    counters.end_path(bounce, false);
+                    continue;
+                }
+
+                throughput[path] *= att;
+                from[path] = hit.pos;
+                from_pdf[path] = next_event ? scatter_pdf(mat, hit, out) : 0.0f;
+                set_ray(path, out);
+
+                if (russian_roulette(throughput[path], bounce + 1, settings, samplers[path]))
+                    active.push_back(path);
+                else
+                    counters.end_path(bounce, false);
+            }
+        }
+
+    public:
+        /// <summary>
+        /// Traces one sample for every pixel of `tile`.
+        /// `sampler(x, y)` returns `Utils::Sampler` of pixel sample,
+        /// `camera_ray(x, y, sampler)` returns camera ray of pixel or nullopt if pixel should not be sampled,
+        /// `accumulate(x, y, color, primary, sampled)` receives result and `PrimaryHit` of every pixel.
+        /// </summary>
+        template <typename S, typename F, typename A>
+        void trace(const Tile& tile, const S& sampler, const Primitives::IHittable& world,
+            const Mat::MaterialTable& materials, const Primitives::LightList& lights, const PathSettings& settings, const F& camera_ray, const A& accumulate, size_t& rays)
+        {
+            const uint32_t count = tile.w() * tile.h();
+            resize(count);
+            sampled.assign(count, false);
+
+            // generate
+            active.clear();
+            for (uint32_t path = 0; path < count; path++)
+            {
+                const uint32_t x = tile.x0 + path % tile.w();
+                const uint32_t y = tile.y0 + path / tile.w();
+
+                samplers[path] = sampler(x, y);
+                throughput[path] = glm::vec3(1.0f);
+                radiance[path] = glm::vec3(0.0f);
+                from_pdf[path] = 0.0f;
+                primary[path] = PrimaryHit();
+
+                if (const auto r = camera_ray(x, y, samplers[path]))
+                {
+                    set_ray(path, *r);
+                    sampled[path] = true;
+                    active.push_back(path);
+                }
+            }
+
+            for (int bounce = 0; bounce < settings.max_bounces && !active.empty(); bounce++)
+            {
+                extend(world, materials, lights, bounce, rays);
+                shade(world, materials, lights, bounce, settings, rays);
+            }
+            // paths that ran out of segments
+            for (size_t i = 0; i < active.size(); i++)
+                Utils::thread_counters.end_path(settings.max_bounces - 1, false);
+
+            // accumulate
+            for (uint32_t path = 0; path < count; path++)
+                accumulate(tile.x0 + path % tile.w(), tile.y0 + path / tile.w(), radiance[path], primary[path], static_cast<bool>(sampled[path]));
+        }
+    };
+}
@@ -1,23 +1,175 @@
 #include "shade.h"
 
+namespace
+{
+    constexpr float pi = 3.14159265f;
+
+    // Veach's power heuristic (beta = 2) weight of strategy with density `a` against one with density `b`
+    float power_heuristic(float a, float b)
+    {
+        return a * a / (a * a + b * b);
+    }
+
+    // Iterative path integrator, `first` is optional already known hit of `r`, `primary` optional output of primary hit.
+    glm::vec3 trace_path(const ray& camera_ray, const Primitives::Record* first, const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, Utils::Sampler& sampler, const PathSettings& settings, size_t& rays, PrimaryHit* primary)
+    {
+        Utils::Counters& counters = Utils::thread_counters;
+        ray r(camera_ray.origin, camera_ray.dir);
+        glm::vec3 throughput(1.0f, 1.0f, 1.0f);
+        glm::vec3 radiance(0.0f, 0.0f, 0.0f);
+        // vertex that chose `r` and density of that choice, for weighting of emitters found by it
+        glm::vec3 from = r.origin;
+        float from_pdf = 0.0f;
+        const bool next_event = settings.next_event && !lights.empty();
+
+        int bounce = 0;
+        for (; bounce < settings.max_bounces; bounce++)
+        {
+            std::optional<Primitives::Record> hit;
+            if (bounce == 0 && first != nullptr)
+            {
+                hit = *first;
+            }
+            else
+            {
+                rays += 1;
+                hit = world.intersect(r, 0.001f, std::numeric_limits<float>::infinity());
+            }
+            // packet traced camera ray was counted by the caller
+            if (bounce == 0)
+                counters.primary_rays += first == nullptr ? 1 : 0;
+            else
+                counters.secondary_rays += 1;
+
+            if (bounce == 0 && primary != nullptr)
+                *primary = primary_hit(r, hit ? &*hit : nullptr, materials);
+
+            if (!hit.has_value())
+            {
+                counters.end_path(bounce, true);
+                return radiance + throughput * sky(r);
+            }
+
+            const Mat::Material& mat = materials[hit->mat];
+            if (mat.type == Mat::Type::Emissive)
+            {
+                radiance += throughput * emitted(mat, *hit, lights, from, from_pdf);
+                break;
+            }
+            if (bounce >= mat.max_bounces)
+                break;
+
+            // light segment counts as next bounce, so it is not added at the last vertex
+            if (next_event && samples_lights(mat) && bounce + 1 < settings.max_bounces)
+                radiance += throughput * direct_light(mat, *hit, bounce, world, lights, sampler, rays);
+
+            glm::vec3 att;
+            ray next({}, {});
+            sampler.start_bounce(bounce);
+            if (!mat.scatter(r, *hit, att, next, sampler))
+                break;
+
+            throughput *= att;
+            from = hit->pos;
+            from_pdf = next_event ? scatter_pdf(mat, *hit, next) : 0.0f;
+            r = std::move(next);
+
+            if (!russian_roulette(throughput, bounce + 1, settings, sampler))
+                break;
+        }
+
+        counters.end_path(std::min(bounce, settings.max_bounces - 1), false);
+        return radiance;
+    }
+}
+
+float scatter_pdf(const Mat::Material& mat, const Primitives::Record& hit, const ray& out)
+{
+    if (!samples_lights(mat))
+        return 0.0f;
+    // cosine weighted hemisphere
+    return std::max(0.0f, glm::dot(hit.norm, glm::normalize(out.dir))) / pi;
+}
+
+glm::vec3 emitted(const Mat::Material& mat, const Primitives::Record& hit, const Primitives::LightList& lights, const glm::vec3& from, float from_pdf)
+{
+    if (!hit.front_face)
+        return glm::vec3(0.0f);
+    if (from_pdf <= 0.0f)
+        return mat.emission;
+    return mat.emission * power_heuristic(from_pdf, lights.pdf(from, hit));
+}
+
+glm::vec3 direct_light(const Mat::Material& mat, const Primitives::Record& hit, int bounce, const Primitives::IHittable& world, const Primitives::LightList& lights, Utils::Sampler& sampler, size_t& rays)
+{
+    sampler.start_bounce(bounce, Utils::Sampler::light_dimension);
+    const glm::vec2 u = sampler.get2d();
+    const float select = sampler.get1d();
+
+    const auto light = lights.sample(hit.pos, select, u);
+    if (!light.has_value())
+        return glm::vec3(0.0f);
+    const float cos_theta = glm::dot(hit.norm, light->dir);
+    if (cos_theta <= 0.0f)
+        return glm::vec3(0.0f);
+
+    // anything between surface and light occludes it, shadow ray stops just before the light itself
+    rays += 1;
+    Utils::thread_counters.shadow_rays += 1;
+    if (world.intersect(ray(hit.pos, light->dir), 0.001f, light->distance * (1.0f - 1e-3f)).has_value())
+        return glm::vec3(0.0f);
+
+    // Lambert BRDF albedo / pi, its sampling density is cos / pi
+    const float bsdf_pdf = cos_theta / pi;
+    return mat.albedo * (bsdf_pdf * power_heuristic(light->pdf, bsdf_pdf) / light->pdf) * light->radiance;
+}
+
 glm::vec3 sky(const ray& r)
 {
     return glm::mix(glm::vec3(1.0f, 1.0f, 1.0f), { 0.5f, 0.7f, 1.0f }, 0.5f * (glm::normalize(r.dir).y + 1.0f));
 }
 
-glm::vec3 gen_color(const ray& r, const Primitives::IHittable& world, std::mt19937& random, int depth)
+bool russian_roulette(glm::vec3& throughput, int bounce, const PathSettings& settings, Utils::Sampler& sampler)
 {
-    if (depth <= 0)
-        return { 0.0f, 0.0f, 0.0f };
+    if (!settings.roulette || bounce < settings.roulette_depth)
+        return true;
 
-    if (auto result = world.intersect(r, 0.001, std::numeric_limits<float>::infinity()))
+    const float p = std::max(throughput.x, std::max(throughput.y, throughput.z)) / settings.roulette_threshold;
+    if (p >= 1.0f)
+        return true;
+    sampler.start_bounce(bounce - 1, Utils::Sampler::roulette_dimension);
+    if (p <= 0.0f || sampler.get1d() >= p)
+        return false;
+
+    throughput /= p;
+    return true;
+}
+
+PrimaryHit primary_hit(const ray& r, const Primitives::Record* hit, const Mat::MaterialTable& materials)
+{
+    PrimaryHit result;
+    if (hit == nullptr)
     {
-        glm::vec3 att;
-        ray dir({}, {});
-        if (result->mat->scatter(r, *result, att, dir, random))
-            return att * gen_color(dir, world, random, depth - 1);
-        return { 0.0f, 0.0f, 0.0f };
+        result.position = glm::vec4(r.dir, 0.0f);
+        result.guide.albedo = glm::min(sky(r), glm::vec3(1.0f));
+        return result;
     }
 
-    return sky(r);
+    const Mat::Material& mat = materials[hit->mat];
+    result.position = glm::vec4(hit->pos, 1.0f);
+    // glass has no color of its own, what is seen through it is left to the filter
+    result.guide.albedo = mat.type == Mat::Type::Refract ? glm::vec3(1.0f) : mat.albedo;
+    result.guide.normal = hit->norm;
+    result.guide.depth = hit->dis * glm::length(r.dir);
+    return result;
+}
+
+glm::vec3 gen_color(const ray& r, const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, Utils::Sampler& sampler, const PathSettings& settings, size_t& rays, PrimaryHit* primary)
+{
+    return trace_path(r, nullptr, world, materials, lights, sampler, settings, rays, primary);
+}
+
+glm::vec3 shade_hit(const ray& r, const Primitives::Record& hit, const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, Utils::Sampler& sampler, const PathSettings& settings, size_t& rays)
+{
+    return trace_path(r, &hit, world, materials, lights, sampler, settings, rays, nullptr);
 }
@@ -1,13 +1,72 @@
 #pragma once
 #include <glm.hpp>
-#include <random>
 
 #include "../../Utils/VecStuff.h"
+#include "../../Utils/Counters.h"
+#include "../../Utils/Sampler.h"
 
 #include "../Camera/Ray.h"
 #include "../Material/Material.h"
 #include "../Primitives/Hittable.h"
+#include "../Primitives/Lights.h"
+#include "RenderTarget.h"
+
+/// <summary>
+/// Termination rules of path integrator
+/// </summary>
+struct PathSettings
+{
+    // hard limit of traced segments per path
+    int max_bounces = 5;
+
+    // Russian roulette - after `roulette_depth` bounces path whose throughput (max channel) fell below
+    // `roulette_threshold` survives only with probability proportional to it, survivors are reweighted.
+    bool roulette = true;
+    int roulette_depth = 3;
+    float roulette_threshold = 1.0f;
+
+    // Next event estimation - diffuse hits sample scene lights directly, combined with BSDF sampling by MIS.
+    // Off leaves emitters to be found by BSDF sampling alone.
+    bool next_event = true;
+};
 
 glm::vec3 sky(const ray& r);
 
-glm::vec3 gen_color(const ray& r, const Primitives::IHittable& world, std::mt19937& random, int depth);
\ No newline at end of file
+// Applies Russian roulette after `bounce` scattered bounces, reweights `throughput` of survivors.
+// Returns false if path should be terminated.
+bool russian_roulette(glm::vec3& throughput, int bounce, const PathSettings& settings, Utils::Sampler& sampler);
+
+/// <summary>
+/// What camera ray saw first - position for temporal reprojection and denoiser guide
+/// </summary>
+struct PrimaryHit
+{
+    // hit position with w = 1, or ray direction with w = 0 if ray escaped to sky
+    glm::vec4 position = glm::vec4(0.0f);
+    RT::Guide guide;
+};
+
+PrimaryHit primary_hit(const ray& r, const Primitives::Record* hit, const Mat::MaterialTable& materials);
+
+// Materials shaded by next event estimation - light sampling needs BSDF that can be evaluated for any direction
+inline bool samples_lights(const Mat::Material& mat)
+{
+    return mat.type == Mat::Type::Diffuse;
+}
+
+// Solid angle density with which `Material::scatter` at `hit` chooses direction `out`, 0 for materials not sampling lights
+float scatter_pdf(const Mat::Material& mat, const Primitives::Record& hit, const ray& out);
+
+// Radiance of emitter `mat` at `hit` reached from `from`. `from_pdf` is `scatter_pdf` of the bounce that chose the ray,
+// 0 for camera ray or specular bounce - light sampling could not have found these, so they keep full emission.
+// MIS weight uses light pdf of the hit emitter only, emitters missing from `lights` keep full emission too.
+glm::vec3 emitted(const Mat::Material& mat, const Primitives::Record& hit, const Primitives::LightList& lights, const glm::vec3& from, float from_pdf);
+
+// Next event estimation at `hit` - light sample and its shadow ray, weighted against BSDF sampling by power heuristic
+glm::vec3 direct_light(const Mat::Material& mat, const Primitives::Record& hit, int bounce, const Primitives::IHittable& world, const Primitives::LightList& lights, Utils::Sampler& sampler, size_t& rays);
+
+// `primary` (optional) receives `primary_hit` of `r`
+glm::vec3 gen_color(const ray& r, const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, Utils::Sampler& sampler, const PathSettings& settings, size_t& rays, PrimaryHit* primary = nullptr);
+
+// Continues path from already found hit `hit` of ray `r` (used by packet tracing of primary rays)
+glm::vec3 shade_hit(const ray& r, const Primitives::Record& hit, const Primitives::IHittable& world, const Mat::MaterialTable& materials, const Primitives::LightList& lights, Utils::Sampler& sampler, const PathSettings& settings, size_t& rays);
@@ -1,24 +1,82 @@
 #include "Material.h"
 
-bool Mat::Diffuse::scatter(const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, std::mt19937& random) const
+namespace
 {
-	glm::vec3 dir = surface.norm + Utils::Vec3::rnd_unit_sphere(random);
-	out_ray = ray(surface.pos, dir);
-	attenuation = albedo;
-	return true;
+	bool scatter_diffuse(const Mat::Material& mat, const ray& /*in_ray*/, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, Utils::Sampler& sampler)
+	{
+		out_ray = ray(surface.pos, Utils::Vec3::cosine_hemisphere(sampler.get2d(), surface.norm));
+		attenuation = mat.albedo;
+		return true;
+	}
+
+	bool scatter_metalic(const Mat::Material& mat, const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, Utils::Sampler& sampler)
+	{
+		const glm::vec2 u = sampler.get2d();
+		const float w = sampler.get1d();
+		out_ray = ray(surface.pos, glm::reflect(glm::normalize(in_ray.dir), surface.norm) + mat.fuzz * Utils::Vec3::ball_uniform(u, w));
+		attenuation = mat.albedo;
+		return glm::dot(out_ray.dir, surface.norm) > 0;
+	}
+
+	bool scatter_refract(const Mat::Material& mat, const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, Utils::Sampler& /*sampler*/)
+	{
+		float refraction_ratio = surface.front_face ? (1.0f / mat.ior) : mat.ior;
+		const glm::vec3 in_dir = glm::normalize(in_ray.dir);
+		glm::vec3 dir = glm::refract(in_dir, surface.norm, refraction_ratio);
+		// total internal reflection - refract returns zero vector, which would poison the path with NaNs
+		if (dir == glm::vec3(0.0f))
+			dir = glm::reflect(in_dir, surface.norm);
+		out_ray = ray(surface.pos, dir);
+		attenuation = { 1.0, 1.0, 1.0 };
+		return true;
+	}
+}
+
+Mat::Material Mat::Material::diffuse(const glm::vec3& albedo)
+{
+	Material mat;
+	mat.type = Type::Diffuse;
+	mat.albedo = albedo;
+	return mat;
+}
+
+Mat::Material Mat::Material::metalic(const glm::vec3& albedo, float fuzz)
+{
+	Material mat;
+	mat.type = Type::Metalic;
+	mat.albedo = albedo;
+	mat.fuzz = fuzz;
+	return mat;
+}
+
+Mat::Material Mat::Material::refract(float ior)
+{
+	Material mat;
+	mat.type = Type::Refract;
+	mat.ior = ior;
+	return mat;
 }
 
-bool Mat::Metalic::scatter(const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, std::mt19937& random) const
+Mat::Material Mat::Material::emissive(const glm::vec3& radiance)
 {
-    out_ray = ray(surface.pos, glm::reflect(glm::normalize(in_ray.dir), surface.norm) + fuzz * Utils::Vec3::rnd_unit_sphere(random));
-    attenuation = albedo;
-    return glm::dot(out_ray.dir, surface.norm) > 0;
+	Material mat;
+	mat.type = Type::Emissive;
+	mat.emission = radiance;
+	return mat;
 }
 
-bool Mat::Refract::scatter(const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, std::mt19937& random) const
+bool Mat::Material::scatter(const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, Utils::Sampler& sampler) const
 {
-	float refraction_ratio = surface.front_face ? (1.0f / ior) : ior;
-	out_ray = ray(surface.pos, glm::refract(glm::normalize(in_ray.dir), surface.norm, refraction_ratio));
-	attenuation = { 1.0, 1.0, 1.0 };
-	return true;
-}
\ No newline at end of file
+	switch (type)
+	{
+	case Type::Diffuse:
+		return scatter_diffuse(*this, in_ray, surface, attenuation, out_ray, sampler);
+	case Type::Metalic:
+		return scatter_metalic(*this, in_ray, surface, attenuation, out_ray, sampler);
+	case Type::Refract:
+		return scatter_refract(*this, in_ray, surface, attenuation, out_ray, sampler);
+	case Type::Emissive:
+		return false;
+	}
+	return false;
+}
@@ -1,8 +1,11 @@
 #pragma once
 #include "../../Utils/VecStuff.h"
+#include "../../Utils/Sampler.h"
 #include "../Camera/Ray.h"
 #include <glm.hpp>
-#include <random>
+#include <limits>
+#include <vector>
+#include <cstdint>
 
 #include "../Primitives/Hittable.h"
 
@@ -13,36 +16,68 @@ namespace Primitives
 
 namespace Mat
 {
-    class IMaterial
+    enum class Type : uint8_t
     {
-    public:
-        virtual bool scatter(const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, std::mt19937& random) const = 0;
+        Diffuse,
+        Metalic,
+        Refract,
+        // light source, absorbs everything that hits its front side
+        Emissive,
     };
 
-
-    class Diffuse : public IMaterial
+    /// <summary>
+    /// Flat description of surface. Kind is selected by `type` tag, parameters unused by given kind are ignored.
+    /// </summary>
+    struct Material
     {
-    public:
-        Diffuse(const glm::vec3& albedo) : albedo(albedo) {}
-        virtual bool scatter(const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, std::mt19937& random) const override;
-        glm::vec3 albedo;
-    };
+        Type type = Type::Diffuse;
+        glm::vec3 albedo = glm::vec3(1.0f);
+        float fuzz = 0.0f; // Metalic
+        float ior = 1.0f;  // Refract
+        glm::vec3 emission = glm::vec3(0.0f); // Emissive, radiance leaving front side
 
+        // Path reaching this material after this many bounces is terminated (eg. cap diffuse surfaces low
+        // and let glass go deep). Global bounce limit still applies.
+        int max_bounces = std::numeric_limits<int>::max();
 
-    class Metalic : public IMaterial
-    {
-    public:
-        Metalic(glm::vec3 albedo, float fuzz) : albedo(albedo), fuzz(fuzz) {}
-        virtual bool scatter(const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, std::mt19937& random) const override;
-        glm::vec3 albedo;
-        float fuzz;
+        static Material diffuse(const glm::vec3& albedo);
+        static Material metalic(const glm::vec3& albedo, float fuzz);
+        static Material refract(float ior);
+        static Material emissive(const glm::vec3& radiance);
+
+        bool scatter(const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, Utils::Sampler& sampler) const;
     };
 
-    class Refract : public IMaterial
+    // Index of material in scene MaterialTable
+    using Handle = uint32_t;
+
+    /// <summary>
+    /// Scene owned storage of materials, primitives and hit records refer to them by `Handle`.
+    /// </summary>
+    class MaterialTable
     {
+        std::vector<Material> materials;
+
     public:
-        Refract(float ior) : ior(ior) {}
-        virtual bool scatter(const ray& in_ray, const Primitives::Record& surface, glm::vec3& attenuation, ray& out_ray, std::mt19937& random) const override;
-        float ior;
+        Handle add(const Material& material)
+        {
+            materials.push_back(material);
+            return static_cast<Handle>(materials.size() - 1);
+        }
+
+        const Material& operator[](Handle handle) const
+        {
+            return materials[handle];
+        }
+
+        Material& operator[](Handle handle)
+        {
+            return materials[handle];
+        }
+
+        size_t size() const
+        {
+            return materials.size();
+        }
     };
-}
\ No newline at end of file
+}
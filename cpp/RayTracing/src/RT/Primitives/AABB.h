@@ -0,0 +1,88 @@
+#pragma once
+#include <glm.hpp>
+#include <limits>
+#include <algorithm>
+
+#include "../Camera/Ray.h"
+#include "../Camera/RayPacket.h"
+
+namespace Primitives
+{
+    struct AABB
+    {
+        glm::vec3 min = glm::vec3(std::numeric_limits<float>::infinity());
+        glm::vec3 max = glm::vec3(-std::numeric_limits<float>::infinity());
+
+        AABB() = default;
+        AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+        void grow(const glm::vec3& point)
+        {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        void grow(const AABB& other)
+        {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+
+        bool empty() const
+        {
+            return min.x > max.x || min.y > max.y || min.z > max.z;
+        }
+
+        glm::vec3 centroid() const
+        {
+            return (min + max) * 0.5f;
+        }
+
+        float surface_area() const
+        {
+            if (empty())
+                return 0.0f;
+            const auto e = max - min;
+            return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+        }
+
+        /// <summary>
+        /// Slab test, `inv_dir` is 1/ray.dir precomputed by caller.
+        /// Returns distance to entry point or infinity on miss.
+        /// </summary>
+        float intersect(const ray& r, const glm::vec3& inv_dir, float t_min, float t_max) const
+        {
+            const auto t0 = (min - r.origin) * inv_dir;
+            const auto t1 = (max - r.origin) * inv_dir;
+
+            const auto t_near = glm::min(t0, t1);
+            const auto t_far = glm::max(t0, t1);
+
+            const float enter = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, t_min));
+            const float exit = std::min(std::min(t_far.x, t_far.y), std::min(t_far.z, t_max));
+
+            return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+        }
+
+        /// <summary>
+        /// Slab test for every lane of packet, `inv_*` is 1/dir per axis.
+        /// Returns mask of lanes that hit, `enter` receives entry distances.
+        /// </summary>
+        int intersect(const RayPacket& rays, const Utils::float4 inv[3], const Utils::float4& t_min, const Utils::float4& t_max, Utils::float4& enter) const
+        {
+            using Utils::float4;
+
+            const float4 tx0 = (float4(min.x) - rays.ox) * inv[0];
+            const float4 tx1 = (float4(max.x) - rays.ox) * inv[0];
+            const float4 ty0 = (float4(min.y) - rays.oy) * inv[1];
+            const float4 ty1 = (float4(max.y) - rays.oy) * inv[1];
+            const float4 tz0 = (float4(min.z) - rays.oz) * inv[2];
+            const float4 tz1 = (float4(max.z) - rays.oz) * inv[2];
+
+            enter = Utils::max(Utils::max(Utils::min(tx0, tx1), Utils::min(ty0, ty1)), Utils::max(Utils::min(tz0, tz1), t_min));
+            const float4 exit = Utils::min(Utils::min(Utils::max(tx0, tx1), Utils::max(ty0, ty1)), Utils::min(Utils::max(tz0, tz1), t_max));
+
+            return Utils::movemask(enter <= exit) & rays.active;
+        }
+    };
+}
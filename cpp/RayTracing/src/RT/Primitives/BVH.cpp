@@ -0,0 +1,304 @@
+#include "BVH.h"
+#include <algorithm>
+#include <array>
+
+Primitives::BVH::BVH(HitVector&& source, uint32_t max_leaf_size) : max_leaf_size(std::max(max_leaf_size, 1u))
+{
+    std::vector<BuildItem> items;
+    items.reserve(source.size());
+
+    for (uint32_t i = 0; i < source.size(); i++)
+    {
+        const auto box = source[i]->bounds();
+        items.push_back({ box, box.centroid(), i });
+    }
+
+    nodes = build(items, this->max_leaf_size);
+
+    objects.reserve(items.size());
+    for (const auto& item : items)
+        objects.push_back(std::move(source[item.index]));
+
+    source.clear();
+}
+
+namespace
+{
+    using Primitives::AABB;
+    using Node = Primitives::BVH::Node;
+    using BuildItem = Primitives::BVH::BuildItem;
+    constexpr int bin_count = Primitives::BVH::bin_count;
+    constexpr int max_depth = Primitives::BVH::max_depth;
+
+    struct Builder
+    {
+        std::vector<Node>& nodes;
+        uint32_t max_leaf_size;
+
+        void build(std::vector<BuildItem>& items, uint32_t begin, uint32_t end, int depth);
+        uint32_t split_sah(std::vector<BuildItem>& items, uint32_t begin, uint32_t end, const AABB& centroids, const AABB& box) const;
+        uint32_t split_median(std::vector<BuildItem>& items, uint32_t begin, uint32_t end, const AABB& centroids) const;
+    };
+}
+
+std::vector<Primitives::BVH::Node> Primitives::BVH::build(std::vector<BuildItem>& items, uint32_t max_leaf_size)
+{
+    std::vector<Node> nodes;
+    nodes.reserve(items.size() * 2);
+
+    Builder builder{ nodes, std::max(max_leaf_size, 1u) };
+    if (!items.empty())
+        builder.build(items, 0, static_cast<uint32_t>(items.size()), 0);
+
+    nodes.shrink_to_fit();
+    return nodes;
+}
+
+void Builder::build(std::vector<BuildItem>& items, uint32_t begin, uint32_t end, int depth)
+{
+    const uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    AABB box, centroids;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        box.grow(items[i].box);
+        centroids.grow(items[i].centroid);
+    }
+
+    nodes[index].box = box;
+
+    const uint32_t count = end - begin;
+    uint32_t mid = begin;
+
+    // Traversal stacks hold `max_depth` entries, so leaf depth must stay below it. SAH is used while balanced
+    // median splits of the rest still fit, deepest level is always leaf (oversized only for degenerate input).
+    if (count > max_leaf_size && centroids.min != centroids.max && depth < max_depth - 1)
+    {
+        int median_levels = 0;
+        for (uint32_t leaves = (count - 1) / max_leaf_size; leaves > 0; leaves >>= 1)
+            median_levels += 1;
+        mid = depth + median_levels < max_depth - 1 ? split_sah(items, begin, end, centroids, box) : split_median(items, begin, end, centroids);
+    }
+
+    if (mid == begin || mid == end)
+    {
+        nodes[index].offset = begin;
+        nodes[index].count = count;
+        return;
+    }
+
+    build(items, begin, mid, depth + 1);
+    nodes[index].offset = static_cast<uint32_t>(nodes.size());
+    nodes[index].count = 0;
+    build(items, mid, end, depth + 1);
+}
+
+uint32_t Builder::split_sah(std::vector<BuildItem>& items, uint32_t begin, uint32_t end, const AABB& centroids, const AABB& box) const
+{
+    struct Bin
+    {
+        AABB box;
+        uint32_t count = 0;
+    };
+
+    const uint32_t count = end - begin;
+    const glm::vec3 extent = centroids.max - centroids.min;
+
+    float best_cost = std::numeric_limits<float>::infinity();
+    int best_axis = -1;
+    int best_split = 0;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (extent[axis] <= 0.0f)
+            continue;
+
+        std::array<Bin, bin_count> bins{};
+        const float scale = bin_count / extent[axis];
+
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const int b = std::min(bin_count - 1, static_cast<int>((items[i].centroid[axis] - centroids.min[axis]) * scale));
+            bins[b].count += 1;
+            bins[b].box.grow(items[i].box);
+        }
+
+        // sweep from right, remember area and count of everything right to split plane
+        std::array<float, bin_count - 1> right_area{};
+        std::array<uint32_t, bin_count - 1> right_count{};
+        AABB acc;
+        uint32_t acc_count = 0;
+        for (int b = bin_count - 1; b > 0; b--)
+        {
+            acc.grow(bins[b].box);
+            acc_count += bins[b].count;
+            right_area[b - 1] = acc.surface_area();
+            right_count[b - 1] = acc_count;
+        }
+
+        acc = AABB();
+        acc_count = 0;
+        for (int b = 0; b < bin_count - 1; b++)
+        {
+            acc.grow(bins[b].box);
+            acc_count += bins[b].count;
+
+            if (acc_count == 0 || right_count[b] == 0)
+                continue;
+
+            const float cost = acc.surface_area() * acc_count + right_area[b] * right_count[b];
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = b;
+            }
+        }
+    }
+
+    // Returning `begin` makes a leaf - splitting should be cheaper than testing every object in this node.
+    if (best_axis < 0)
+        return begin;
+
+    const float leaf_cost = box.surface_area() * count;
+    if (best_cost >= leaf_cost && count <= max_leaf_size * 4)
+        return begin;
+
+    const float scale = bin_count / extent[best_axis];
+    const float low = centroids.min[best_axis];
+    const auto it = std::partition(items.begin() + begin, items.begin() + end, [&](const BuildItem& item)
+        {
+            return std::min(bin_count - 1, static_cast<int>((item.centroid[best_axis] - low) * scale)) <= best_split;
+        });
+
+    return static_cast<uint32_t>(it - items.begin());
+}
+
+uint32_t Builder::split_median(std::vector<BuildItem>& items, uint32_t begin, uint32_t end, const AABB& centroids) const
+{
+    const glm::vec3 extent = centroids.max - centroids.min;
+    const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    const uint32_t mid = begin + (end - begin) / 2;
+
+    std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end, [axis](const BuildItem& a, const BuildItem& b)
+        {
+            return a.centroid[axis] < b.centroid[axis];
+        });
+
+    return mid;
+}
+
+std::optional<Primitives::Record> Primitives::BVH::intersect(const ray& r, float min, float max) const
+{
+    float t = max;
+    std::optional<Record> hit = std::nullopt;
+
+    traverse(nodes.data(), nodes.size(), r, min, t, [&](const Node& node, float& t)
+        {
+            for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+            {
+                if (auto result = objects[i]->intersect(r, min, t))
+                {
+                    t = result->dis;
+                    hit = result;
+                }
+            }
+        });
+
+    return hit;
+}
+
+void Primitives::BVH::intersect_packet(const RayPacket& rays, float min, HitPacket& hits) const
+{
+    using Utils::float4;
+
+    if (nodes.empty() || rays.active == 0)
+        return;
+
+    const float4 inv[3] = { float4(1.0f) / rays.dx, float4(1.0f) / rays.dy, float4(1.0f) / rays.dz };
+    const float4 t_min(min);
+
+    // smallest entry distance among lanes that hit the box
+    auto closest = [](const float4& enter, int mask)
+    {
+        alignas(16) float dist[RayPacket::width];
+        enter.store(dist);
+        float result = std::numeric_limits<float>::infinity();
+        for (int lane = 0; lane < RayPacket::width; lane++)
+            if (mask >> lane & 1)
+                result = std::min(result, dist[lane]);
+        return result;
+    };
+
+    uint32_t stack[max_depth];
+    int top = 0;
+    uint32_t current = 0;
+    float4 enter;
+
+    Utils::Counters& counters = Utils::thread_counters;
+    counters.box_tests += 1;
+    if (nodes[0].box.intersect(rays, inv, t_min, float4::load(hits.t), enter) == 0)
+        return;
+
+    uint64_t box_tests = 0, primitive_tests = 0;
+
+    while (true)
+    {
+        const Node& node = nodes[current];
+
+        if (node.is_leaf())
+        {
+            primitive_tests += node.count;
+            for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+                objects[i]->intersect_packet(rays, min, hits);
+        }
+        else
+        {
+            box_tests += 2;
+            const float4 t_max = float4::load(hits.t);
+            uint32_t near_node = current + 1;
+            uint32_t far_node = node.offset;
+            float4 near_enter, far_enter;
+            int near_mask = nodes[near_node].box.intersect(rays, inv, t_min, t_max, near_enter);
+            int far_mask = nodes[far_node].box.intersect(rays, inv, t_min, t_max, far_enter);
+
+            if (near_mask != 0 && far_mask != 0)
+            {
+                if (closest(far_enter, far_mask) < closest(near_enter, near_mask))
+                    std::swap(near_node, far_node);
+                stack[top++] = far_node;
+                current = near_node;
+                continue;
+            }
+            if (near_mask != 0 || far_mask != 0)
+            {
+                current = near_mask != 0 ? near_node : far_node;
+                continue;
+            }
+        }
+
+        // pop next node, hits found meanwhile could have made it unreachable for every lane
+        bool found = false;
+        while (top > 0)
+        {
+            current = stack[--top];
+            box_tests += 1;
+            if (nodes[current].box.intersect(rays, inv, t_min, float4::load(hits.t), enter) != 0)
+            {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            break;
+    }
+
+    counters.box_tests += box_tests;
+    counters.primitive_tests += primitive_tests;
+}
+
+Primitives::AABB Primitives::BVH::bounds() const
+{
+    return nodes.empty() ? AABB() : nodes[0].box;
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include "Hittable.h"
+#include "HitVector.h"
+#include "AABB.h"
+#include "../../Utils/Counters.h"
+
+
+namespace Primitives
+{
+    /// <summary>
+    /// Bounding volume hierarchy built with binned SAH.
+    /// Nodes are stored depth-first in one array: left child of node `i` is always `i + 1`,
+    /// right child is stored in `offset`. Leaves reference contiguous range of `objects`.
+    /// </summary>
+    class BVH : public IHittable
+    {
+    public:
+        struct Node
+        {
+            AABB box;
+            uint32_t offset; // leaf: first object, inner: index of right child
+            uint32_t count;  // 0 for inner nodes
+
+            bool is_leaf() const { return count != 0; }
+        };
+
+        static_assert(sizeof(Node) == 32, "BVH node should fit in half of cache line.");
+
+        static constexpr int max_depth = 64;
+        static constexpr int bin_count = 12;
+
+        struct BuildItem
+        {
+            AABB box;
+            glm::vec3 centroid;
+            uint32_t index;
+        };
+
+        explicit BVH(HitVector&& objects, uint32_t max_leaf_size = 4);
+
+        std::optional<Record> intersect(const ray& ray, float min, float max) const override;
+        void intersect_packet(const RayPacket& rays, float min, HitPacket& hits) const override;
+        AABB bounds() const override;
+
+        size_t node_count() const { return nodes.size(); }
+        size_t object_count() const { return objects.size(); }
+
+        /// <summary>
+        /// Builds nodes over `items` (binned SAH, median splits near depth limit, no leaf deeper than `max_depth` - 1).
+        /// `items` are reordered so that every leaf references contiguous range of them.
+        /// </summary>
+        static std::vector<Node> build(std::vector<BuildItem>& items, uint32_t max_leaf_size);
+
+        /// <summary>
+        /// Closest hit traversal of `count` nodes. `leaf(node, t)` is called for every leaf whose box starts before `t`,
+        /// nearer child first, and lowers `t` when it finds closer hit.
+        /// </summary>
+        template <typename F>
+        static void traverse(const Node* nodes, size_t count, const ray& r, float min, float& t, const F& leaf)
+        {
+            if (count == 0)
+                return;
+
+            struct Entry
+            {
+                uint32_t node;
+                float dist;
+            };
+
+            const glm::vec3 inv_dir = 1.0f / r.dir;
+            const float miss = std::numeric_limits<float>::infinity();
+
+            Entry stack[max_depth];
+            int top = 0;
+
+            Utils::Counters& counters = Utils::thread_counters;
+            counters.box_tests += 1;
+            if (nodes[0].box.intersect(r, inv_dir, min, t) == miss)
+                return;
+
+            // counted locally, thread local counters are updated once per traversal
+            uint64_t box_tests = 0, primitive_tests = 0;
+            uint32_t current = 0;
+            while (true)
+            {
+                const Node& node = nodes[current];
+
+                if (node.is_leaf())
+                {
+                    primitive_tests += node.count;
+                    leaf(node, t);
+                }
+                else
+                {
+                    box_tests += 2;
+                    uint32_t near_node = current + 1;
+                    uint32_t far_node = node.offset;
+                    float near_dist = nodes[near_node].box.intersect(r, inv_dir, min, t);
+                    float far_dist = nodes[far_node].box.intersect(r, inv_dir, min, t);
+
+                    if (far_dist < near_dist)
+                    {
+                        std::swap(near_node, far_node);
+                        std::swap(near_dist, far_dist);
+                    }
+
+                    if (near_dist != miss)
+                    {
+                        if (far_dist != miss)
+                            stack[top++] = { far_node, far_dist };
+                        current = near_node;
+                        continue;
+                    }
+                }
+
+                // pop next node, skipping these that start behind closest hit
+                bool found = false;
+                while (top > 0)
+                {
+                    const Entry entry = stack[--top];
+                    if (entry.dist <= t)
+                    {
+                        current = entry.node;
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found)
+                    break;
+            }
+
+            counters.box_tests += box_tests;
+            counters.primitive_tests += primitive_tests;
+        }
+
+    private:
+        // objects reordered so that every leaf points to continuous range
+        HitVector objects;
+        std::vector<Node> nodes;
+        uint32_t max_leaf_size;
+    };
+}
@@ -25,5 +25,19 @@ namespace Primitives
 
 			return hit;
 		}
+
+		void intersect_packet(const RayPacket& rays, float min, HitPacket& hits) const override
+		{
+			for (const auto& obj : *this)
+				obj->intersect_packet(rays, min, hits);
+		}
+
+		AABB bounds() const override
+		{
+			AABB box;
+			for (const auto& obj : *this)
+				box.grow(obj->bounds());
+			return box;
+		}
 	};
 }
\ No newline at end of file
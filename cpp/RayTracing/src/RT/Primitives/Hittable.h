@@ -2,16 +2,13 @@
 #include <optional>
 #include <glm.hpp>
 #include <memory>
+#include <cstdint>
 
 #include "../../Utils/VecStuff.h"
 
 #include "../Camera/Ray.h"
-#include "../Material/Material.h"
-
-namespace Mat
-{
-	class IMaterial;
-}
+#include "../Camera/RayPacket.h"
+#include "AABB.h"
 
 namespace Primitives
 {
@@ -21,9 +18,9 @@ namespace Primitives
 		glm::vec3 norm;
 		float dis;
 		bool front_face;
-		std::shared_ptr<Mat::IMaterial> mat;
+		uint32_t mat; // handle in scene Mat::MaterialTable
 
-		static Record from(const glm::vec3& pos, const glm::vec3& norm, float dis, const ray& r, std::shared_ptr<Mat::IMaterial> mat)
+		static Record from(const glm::vec3& pos, const glm::vec3& norm, float dis, const ray& r, uint32_t mat)
 		{
 			auto rec = Record{ pos, norm, dis, true, mat };
 			if (dot(r.dir, norm) > 0)
@@ -35,10 +32,44 @@ namespace Primitives
 		}
 	};
 
+	/// <summary>
+	/// Closest hits for RayPacket lanes, `t` is closest distance found so far (search upper bound).
+	/// </summary>
+	struct HitPacket
+	{
+		alignas(16) float t[RayPacket::width];
+		std::optional<Record> rec[RayPacket::width];
+
+		explicit HitPacket(float max)
+		{
+			for (auto& v : t)
+				v = max;
+		}
+	};
+
 	class IHittable
 	{
 	public:
 		virtual std::optional<Record> intersect(const ray& ray, float min, float max) const = 0;
+		virtual AABB bounds() const = 0;
+
+		/// <summary>
+		/// Intersects every active lane of packet, updates `hits` only where closer hit was found.
+		/// Default implementation falls back to scalar `intersect` per lane.
+		/// </summary>
+		virtual void intersect_packet(const RayPacket& rays, float min, HitPacket& hits) const
+		{
+			for (int lane = 0; lane < RayPacket::width; lane++)
+			{
+				if ((rays.active >> lane & 1) == 0)
+					continue;
+				if (auto result = intersect(rays.get(lane), min, hits.t[lane]))
+				{
+					hits.t[lane] = result->dis;
+					hits.rec[lane] = result;
+				}
+			}
+		}
 
 		IHittable() = default;
 		IHittable(const IHittable&) = default;
@@ -0,0 +1,69 @@
+#pragma once
+#include <memory>
+#include <glm.hpp>
+#include "Hittable.h"
+
+
+namespace Primitives
+{
+    /// <summary>
+    /// Placement of shared object with affine transform. Ray is moved into object space instead of moving the object,
+    /// its direction is not renormalized there, so hit distance is the same in both spaces.
+    /// </summary>
+    class Instance : public IHittable
+    {
+        std::shared_ptr<const IHittable> object;
+        glm::mat4 to_world;
+        glm::mat4 to_object;
+        // inverse transpose of linear part, transforms normals
+        glm::mat3 normal_matrix;
+        AABB box;
+
+    public:
+        Instance(std::shared_ptr<const IHittable> object, const glm::mat4& transform) : object(std::move(object))
+        {
+            set_transform(transform);
+        }
+
+        /// <summary>
+        /// Moves instance, bounds are recomputed (structure containing instance has to be rebuilt)
+        /// </summary>
+        void set_transform(const glm::mat4& transform)
+        {
+            to_world = transform;
+            to_object = glm::inverse(transform);
+            normal_matrix = glm::transpose(glm::mat3(to_object));
+
+            // box around transformed corners of object box
+            const AABB local = object->bounds();
+            box = AABB();
+            for (int corner = 0; corner < 8; corner++)
+            {
+                const glm::vec3 p(corner & 1 ? local.max.x : local.min.x, corner & 2 ? local.max.y : local.min.y, corner & 4 ? local.max.z : local.min.z);
+                box.grow(glm::vec3(to_world * glm::vec4(p, 1.0f)));
+            }
+        }
+
+        const glm::mat4& transform() const { return to_world; }
+        const std::shared_ptr<const IHittable>& get_object() const { return object; }
+
+        std::optional<Record> intersect(const ray& r, float min, float max) const override
+        {
+            const ray local(glm::vec3(to_object * glm::vec4(r.origin, 1.0f)), glm::vec3(to_object * glm::vec4(r.dir, 0.0f)));
+
+            auto hit = object->intersect(local, min, max);
+            if (!hit)
+                return hit;
+
+            // dot(M d, M^-T n) = dot(d, n), so side of the surface (and front_face) is kept
+            hit->pos = r.at(hit->dis);
+            hit->norm = glm::normalize(normal_matrix * hit->norm);
+            return hit;
+        }
+
+        AABB bounds() const override
+        {
+            return box;
+        }
+    };
+}
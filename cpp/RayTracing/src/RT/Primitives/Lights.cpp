@@ -0,0 +1,131 @@
+#include "Lights.h"
+#include <cmath>
+#include <algorithm>
+#include "Sphere.h"
+
+namespace
+{
+    constexpr float pi = 3.14159265f;
+
+    /// <summary>
+    /// Cone of directions from point to sphere, `one_minus_cos` of its half angle is computed from sine,
+    /// so it keeps precision for small distant lights
+    /// </summary>
+    struct Cone
+    {
+        glm::vec3 axis;
+        float distance;
+        float cos_max;
+        float one_minus_cos;
+    };
+
+    std::optional<Cone> cone(const glm::vec3& pos, const glm::vec3& origin, float radius)
+    {
+        const glm::vec3 d = origin - pos;
+        const float dist_sq = glm::dot(d, d);
+        const float sin_sq = radius * radius / dist_sq;
+        // inside or on the light
+        if (!(sin_sq < 1.0f))
+            return std::nullopt;
+
+        const float distance = std::sqrt(dist_sq);
+        const float cos_max = std::sqrt(1.0f - sin_sq);
+        return Cone{ d / distance, distance, cos_max, sin_sq / (1.0f + cos_max) };
+    }
+
+    // orthonormal basis around unit `n` (Duff et al. 2017)
+    void basis(const glm::vec3& n, glm::vec3& t, glm::vec3& b)
+    {
+        const float sign = std::copysign(1.0f, n.z);
+        const float a = -1.0f / (sign + n.z);
+        const float c = n.x * n.y * a;
+        t = glm::vec3(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+        b = glm::vec3(c, sign + n.y * n.y * a, -n.y);
+    }
+}
+
+Primitives::LightList Primitives::LightList::collect(const HitVector& world, const Mat::MaterialTable& materials)
+{
+    LightList list;
+    for (const auto& object : world)
+    {
+        const auto* sphere = dynamic_cast<const Sphere*>(object.get());
+        if (sphere != nullptr && materials[sphere->mat].type == Mat::Type::Emissive)
+            list.add(sphere->origin, sphere->radius, materials[sphere->mat].emission, sphere->mat);
+    }
+    list.finalize();
+    return list;
+}
+
+void Primitives::LightList::add(const glm::vec3& origin, float radius, const glm::vec3& radiance, uint32_t mat)
+{
+    lights.push_back({ origin, radius, radiance, mat });
+}
+
+void Primitives::LightList::finalize()
+{
+    // power of sphere light is proportional to its area and radiance
+    std::vector<float> power;
+    float total = 0.0f;
+    for (const SphereLight& light : lights)
+    {
+        power.push_back(light.radius * light.radius * (light.radiance.x + light.radiance.y + light.radiance.z));
+        total += power.back();
+    }
+
+    probability.resize(lights.size());
+    cdf.resize(lights.size());
+    if (lights.empty())
+        return;
+    float sum = 0.0f;
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        probability[i] = total > 0.0f ? power[i] / total : 1.0f / lights.size();
+        sum += probability[i];
+        cdf[i] = sum;
+    }
+    // rounding must not leave `select` close to 1 without light
+    cdf.back() = 1.0f;
+}
+
+std::optional<Primitives::LightSample> Primitives::LightList::sample(const glm::vec3& pos, float select, const glm::vec2& u) const
+{
+    if (lights.empty())
+        return std::nullopt;
+
+    const size_t index = std::min<size_t>(std::upper_bound(cdf.begin(), cdf.end(), select) - cdf.begin(), lights.size() - 1);
+    const SphereLight& light = lights[index];
+    const auto c = cone(pos, light.origin, light.radius);
+    if (!c.has_value())
+        return std::nullopt;
+
+    // uniform in cone
+    const float one_minus_cos = u.x * c->one_minus_cos;
+    const float cos_theta = 1.0f - one_minus_cos;
+    const float sin_theta = std::sqrt(std::max(0.0f, one_minus_cos * (2.0f - one_minus_cos)));
+    const float phi = 2.0f * pi * u.y;
+    glm::vec3 t, b;
+    basis(c->axis, t, b);
+    const glm::vec3 dir = glm::normalize(c->axis * cos_theta + (t * std::cos(phi) + b * std::sin(phi)) * sin_theta);
+
+    // nearer intersection with sphere, chord half length from distance of its center to the direction
+    const float along = c->distance * cos_theta;
+    const float offset = c->distance * c->distance * sin_theta * sin_theta;
+    const float distance = along - std::sqrt(std::max(0.0f, light.radius * light.radius - offset));
+
+    return LightSample{ dir, distance, light.radiance, probability[index] / (2.0f * pi * c->one_minus_cos) };
+}
+
+float Primitives::LightList::pdf(const glm::vec3& pos, const Record& hit) const
+{
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        // hit light is the one of the same material with `hit` on its surface
+        const SphereLight& light = lights[i];
+        if (light.mat != hit.mat || std::abs(glm::length(hit.pos - light.origin) - light.radius) > 1e-3f * light.radius)
+            continue;
+        const auto c = cone(pos, light.origin, light.radius);
+        return c.has_value() ? probability[i] / (2.0f * pi * c->one_minus_cos) : 0.0f;
+    }
+    return 0.0f;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <optional>
+#include <glm.hpp>
+
+#include "HitVector.h"
+#include "../Material/Material.h"
+
+namespace Primitives
+{
+    /// <summary>
+    /// Direction from shading point towards light, `pdf` is solid angle density including choice of the light
+    /// </summary>
+    struct LightSample
+    {
+        glm::vec3 dir;
+        // distance to light surface along `dir`, shadow ray ends before it
+        float distance;
+        glm::vec3 radiance;
+        float pdf;
+    };
+
+    /// <summary>
+    /// Emitters of scene for next event estimation. Lights are emissive spheres, every one is sampled
+    /// uniformly over cone it subtends from shading point, so small distant lights are as cheap to hit as big ones.
+    /// Light is chosen in proportion to its power.
+    /// </summary>
+    class LightList
+    {
+        struct SphereLight
+        {
+            glm::vec3 origin;
+            float radius;
+            glm::vec3 radiance;
+            uint32_t mat;
+        };
+
+        std::vector<SphereLight> lights;
+        // selection probability and running sum of it (upper end of light's interval)
+        std::vector<float> probability;
+        std::vector<float> cdf;
+
+    public:
+        /// <summary>
+        /// Collects top level spheres of `world` with emissive material. Emitters inside sets, meshes or
+        /// instances are still hit by paths, only they are not sampled directly.
+        /// </summary>
+        static LightList collect(const HitVector& world, const Mat::MaterialTable& materials);
+
+        /// <summary>
+        /// Appends light, `finalize` must be called after the last one and before sampling
+        /// </summary>
+        void add(const glm::vec3& origin, float radius, const glm::vec3& radiance, uint32_t mat);
+
+        /// <summary>
+        /// Builds selection probabilities of all added lights in proportion to their power
+        /// </summary>
+        void finalize();
+
+        bool empty() const
+        {
+            return lights.empty();
+        }
+
+        size_t size() const
+        {
+            return lights.size();
+        }
+
+        /// <summary>
+        /// Picks light by `select` and direction towards it by `u` (both uniform in [0, 1)).
+        /// Nullopt if there are no lights or `pos` is inside of picked one.
+        /// </summary>
+        std::optional<LightSample> sample(const glm::vec3& pos, float select, const glm::vec2& u) const;
+
+        /// <summary>
+        /// Density with which `sample` from `pos` picks emitter hit `hit` - only the light that was hit counts,
+        /// light samples towards the others are occluded by it. 0 for emitters not in the list, they are never sampled.
+        /// </summary>
+        float pdf(const glm::vec3& pos, const Record& hit) const;
+    };
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <glm.hpp>
+#include <limits>
 #include "Hittable.h"
 
 
@@ -11,11 +12,14 @@ namespace Primitives
         glm::vec3 origin;
         float radius;
 
-        std::shared_ptr<Mat::IMaterial> mat;
+        uint32_t mat;
 
-        Sphere(glm::vec3 origin, float radius, std::shared_ptr<Mat::IMaterial> mat) : origin(origin), radius(radius), mat(mat) {}
+        Sphere(glm::vec3 origin, float radius, uint32_t mat) : origin(origin), radius(radius), mat(mat) {}
 
-        std::optional<Record> intersect(const ray& ray, float min, float max) const override
+        /// <summary>
+        /// Distance to closest hit in [min, max] or infinity, does not build Record
+        /// </summary>
+        float distance(const ray& ray, float min, float max) const
         {
             const auto oc = ray.origin - origin;
             const auto a = Utils::Vec3::sqr_lenght(ray.dir);
@@ -23,7 +27,7 @@ namespace Primitives
             const auto c = Utils::Vec3::sqr_lenght(oc) - radius * radius;
 
             auto discriminant = half_b * half_b - a * c;
-            if (discriminant < 0) return {};
+            if (discriminant < 0) return std::numeric_limits<float>::infinity();
             auto sqrtd = sqrt(discriminant);
 
 
@@ -32,14 +36,79 @@ namespace Primitives
             {
                 root = (-half_b + sqrtd) / a;
                 if (root < min || max < root)
-                    return {};
+                    return std::numeric_limits<float>::infinity();
             }
 
+            return root;
+        }
 
-            glm::vec3 pos = ray.at(root);
+        Record record(const ray& ray, float t) const
+        {
+            glm::vec3 pos = ray.at(t);
             glm::vec3 norm = (pos - origin) / radius;
 
-            return Record::from(pos, norm, root, ray, mat);
+            return Record::from(pos, norm, t, ray, mat);
+        }
+
+        std::optional<Record> intersect(const ray& ray, float min, float max) const override
+        {
+            const float t = distance(ray, min, max);
+            if (t == std::numeric_limits<float>::infinity())
+                return {};
+            return record(ray, t);
+        }
+
+        void intersect_packet(const RayPacket& rays, float min, HitPacket& hits) const override
+        {
+            using Utils::float4;
+
+            const float4 ocx = rays.ox - float4(origin.x);
+            const float4 ocy = rays.oy - float4(origin.y);
+            const float4 ocz = rays.oz - float4(origin.z);
+
+            const float4 a = rays.dx * rays.dx + rays.dy * rays.dy + rays.dz * rays.dz;
+            const float4 half_b = ocx * rays.dx + ocy * rays.dy + ocz * rays.dz;
+            const float4 c = ocx * ocx + ocy * ocy + ocz * ocz - float4(radius * radius);
+
+            const float4 discriminant = half_b * half_b - a * c;
+            const float4 has_roots = discriminant >= float4(0.0f);
+            if ((Utils::movemask(has_roots) & rays.active) == 0)
+                return;
+
+            const float4 sqrtd = Utils::sqrt(Utils::max(discriminant, float4(0.0f)));
+            const float4 t_min(min);
+            const float4 t_max = float4::load(hits.t);
+
+            const float4 near_root = (float4(0.0f) - half_b - sqrtd) / a;
+            const float4 far_root = (float4(0.0f) - half_b + sqrtd) / a;
+            const float4 near_ok = (near_root >= t_min) & (near_root <= t_max);
+            const float4 far_ok = (far_root >= t_min) & (far_root <= t_max);
+
+            const float4 root = Utils::select(near_ok, near_root, far_root);
+            int hit_lanes = Utils::movemask(has_roots & (near_ok | far_ok)) & rays.active;
+            if (hit_lanes == 0)
+                return;
+
+            // Record is built only for lanes that found closer hit
+            alignas(16) float roots[RayPacket::width];
+            root.store(roots);
+            for (int lane = 0; lane < RayPacket::width; lane++)
+            {
+                if ((hit_lanes >> lane & 1) == 0)
+                    continue;
+
+                const ray r = rays.get(lane);
+                const glm::vec3 pos = r.at(roots[lane]);
+                const glm::vec3 norm = (pos - origin) / radius;
+
+                hits.t[lane] = roots[lane];
+                hits.rec[lane] = Record::from(pos, norm, roots[lane], r, mat);
+            }
+        }
+
+        AABB bounds() const override
+        {
+            return AABB(origin - glm::vec3(radius), origin + glm::vec3(radius));
         }
     };
 }
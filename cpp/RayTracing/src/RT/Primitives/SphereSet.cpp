@@ -0,0 +1,70 @@
+#include "SphereSet.h"
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+#include "../../Utils/asserts.h"
+
+void Primitives::SphereSet::add(const glm::vec3& origin, float r, uint32_t material)
+{
+    assert_less(size(), max_size);
+    cx.push_back(origin.x);
+    cy.push_back(origin.y);
+    cz.push_back(origin.z);
+    radius.push_back(r);
+    mat.push_back(material);
+
+    box.grow(AABB(origin - glm::vec3(r), origin + glm::vec3(r)));
+}
+
+Primitives::HitVector Primitives::SphereSet::split(size_t max_size) const
+{
+    max_size = std::max<size_t>(max_size, 1);
+
+    std::vector<uint32_t> order(size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    HitVector result;
+
+    auto center = [this](uint32_t i) { return glm::vec3(cx[i], cy[i], cz[i]); };
+
+    // explicit stack of [begin, end) ranges still too big for one set
+    std::vector<std::pair<size_t, size_t>> ranges;
+    if (!order.empty())
+        ranges.push_back({ 0, order.size() });
+
+    while (!ranges.empty())
+    {
+        const auto [begin, end] = ranges.back();
+        ranges.pop_back();
+
+        if (end - begin <= max_size)
+        {
+            auto set = std::make_unique<SphereSet>();
+            for (size_t k = begin; k < end; k++)
+            {
+                const uint32_t i = order[k];
+                set->add(center(i), radius[i], mat[i]);
+            }
+            result.push_back(std::move(set));
+            continue;
+        }
+
+        AABB centroids;
+        for (size_t k = begin; k < end; k++)
+            centroids.grow(center(order[k]));
+
+        const glm::vec3 extent = centroids.max - centroids.min;
+        const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        const size_t mid = begin + (end - begin) / 2;
+
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&](uint32_t a, uint32_t b)
+            {
+                return center(a)[axis] < center(b)[axis];
+            });
+
+        ranges.push_back({ mid, end });
+        ranges.push_back({ begin, mid });
+    }
+
+    return result;
+}
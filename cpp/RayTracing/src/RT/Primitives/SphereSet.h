@@ -0,0 +1,207 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <glm.hpp>
+#include "Hittable.h"
+#include "HitVector.h"
+#include "../../Utils/Simd.h"
+
+
+namespace Primitives
+{
+    /// <summary>
+    /// Spheres stored as structure of arrays. One ray is tested against 4 spheres per iteration,
+    /// only closest distance and index are tracked and `Record` is built once for the winning sphere.
+    /// </summary>
+    class SphereSet : public IHittable
+    {
+        std::vector<float> cx, cy, cz, radius;
+        std::vector<uint32_t> mat;
+        AABB box;
+
+        Record make_record(const ray& r, uint32_t index, float t) const
+        {
+            const glm::vec3 origin(cx[index], cy[index], cz[index]);
+            const glm::vec3 pos = r.at(t);
+            const glm::vec3 norm = (pos - origin) / radius[index];
+            return Record::from(pos, norm, t, r, mat[index]);
+        }
+
+    public:
+        static constexpr size_t width = 4;
+        // `intersect` tracks sphere indices in float lanes, which are exact only below 2^24
+        static constexpr size_t max_size = size_t(1) << 24;
+
+        /// <summary>
+        /// Appends sphere, set must stay smaller than `max_size` (checked, exits otherwise)
+        /// </summary>
+        void add(const glm::vec3& origin, float r, uint32_t material);
+
+        size_t size() const { return radius.size(); }
+        glm::vec3 get_center(size_t i) const { return glm::vec3(cx[i], cy[i], cz[i]); }
+        float get_radius(size_t i) const { return radius[i]; }
+        uint32_t get_material(size_t i) const { return mat[i]; }
+        bool empty() const { return radius.empty(); }
+
+        /// <summary>
+        /// Splits spheres into spatially coherent sets of at most `max_size` (median split along longest axis),
+        /// meant to be used as leaves of BVH.
+        /// </summary>
+        HitVector split(size_t max_size) const;
+
+        std::optional<Record> intersect(const ray& r, float min, float max) const override
+        {
+            using Utils::float4;
+
+            const size_t count = size();
+            const size_t simd_count = count - count % width;
+
+            const float a = Utils::Vec3::sqr_lenght(r.dir);
+            const float4 a4(a);
+            const float4 dx(r.dir.x), dy(r.dir.y), dz(r.dir.z);
+            const float4 ox(r.origin.x), oy(r.origin.y), oz(r.origin.z);
+            const float4 t_min(min);
+
+            float4 best_t(max);
+            float4 best_index(-1.0f);
+            float4 index(0.0f, 1.0f, 2.0f, 3.0f);
+
+            for (size_t i = 0; i < simd_count; i += width)
+            {
+                const float4 rad = float4::loadu(&radius[i]);
+                const float4 ocx = ox - float4::loadu(&cx[i]);
+                const float4 ocy = oy - float4::loadu(&cy[i]);
+                const float4 ocz = oz - float4::loadu(&cz[i]);
+
+                const float4 half_b = ocx * dx + ocy * dy + ocz * dz;
+                const float4 c = ocx * ocx + ocy * ocy + ocz * ocz - rad * rad;
+                const float4 discriminant = half_b * half_b - a4 * c;
+                const float4 has_roots = discriminant >= float4(0.0f);
+
+                if (Utils::movemask(has_roots) != 0)
+                {
+                    const float4 sqrtd = Utils::sqrt(Utils::max(discriminant, float4(0.0f)));
+                    const float4 near_root = (float4(0.0f) - half_b - sqrtd) / a4;
+                    const float4 far_root = (float4(0.0f) - half_b + sqrtd) / a4;
+                    const float4 near_ok = (near_root >= t_min) & (near_root <= best_t);
+                    const float4 far_ok = (far_root >= t_min) & (far_root <= best_t);
+
+                    const float4 root = Utils::select(near_ok, near_root, far_root);
+                    const float4 closer = has_roots & (near_ok | far_ok);
+
+                    best_t = Utils::select(closer, root, best_t);
+                    best_index = Utils::select(closer, index, best_index);
+                }
+
+                index = index + float4(static_cast<float>(width));
+            }
+
+            // reduce lanes, float index is exact as set is smaller than `max_size`
+            alignas(16) float lane_t[width];
+            alignas(16) float lane_index[width];
+            best_t.store(lane_t);
+            best_index.store(lane_index);
+
+            float t = max;
+            int64_t hit = -1;
+            for (size_t lane = 0; lane < width; lane++)
+            {
+                if (lane_index[lane] >= 0.0f && lane_t[lane] <= t)
+                {
+                    t = lane_t[lane];
+                    hit = static_cast<int64_t>(lane_index[lane]);
+                }
+            }
+
+            // scalar tail
+            for (size_t i = simd_count; i < count; i++)
+            {
+                const glm::vec3 oc = r.origin - glm::vec3(cx[i], cy[i], cz[i]);
+                const float half_b = glm::dot(oc, r.dir);
+                const float c = Utils::Vec3::sqr_lenght(oc) - radius[i] * radius[i];
+
+                const float discriminant = half_b * half_b - a * c;
+                if (discriminant < 0)
+                    continue;
+                const float sqrtd = std::sqrt(discriminant);
+
+                float root = (-half_b - sqrtd) / a;
+                if (root < min || t < root)
+                {
+                    root = (-half_b + sqrtd) / a;
+                    if (root < min || t < root)
+                        continue;
+                }
+
+                t = root;
+                hit = static_cast<int64_t>(i);
+            }
+
+            if (hit < 0)
+                return {};
+            return make_record(r, static_cast<uint32_t>(hit), t);
+        }
+
+        void intersect_packet(const RayPacket& rays, float min, HitPacket& hits) const override
+        {
+            using Utils::float4;
+
+            if (rays.active == 0)
+                return;
+
+            // packet goes across lanes, so spheres are visited one by one
+            const float4 a = rays.dx * rays.dx + rays.dy * rays.dy + rays.dz * rays.dz;
+            const float4 t_min(min);
+            const float4 active_mask = Utils::lane_mask(rays.active);
+
+            float4 best_t = float4::load(hits.t);
+            float4 best_index(-1.0f);
+
+            for (size_t i = 0; i < size(); i++)
+            {
+                const float4 ocx = rays.ox - float4(cx[i]);
+                const float4 ocy = rays.oy - float4(cy[i]);
+                const float4 ocz = rays.oz - float4(cz[i]);
+
+                const float4 half_b = ocx * rays.dx + ocy * rays.dy + ocz * rays.dz;
+                const float4 c = ocx * ocx + ocy * ocy + ocz * ocz - float4(radius[i] * radius[i]);
+                const float4 discriminant = half_b * half_b - a * c;
+                const float4 has_roots = active_mask & (discriminant >= float4(0.0f));
+                if (Utils::movemask(has_roots) == 0)
+                    continue;
+
+                const float4 sqrtd = Utils::sqrt(Utils::max(discriminant, float4(0.0f)));
+                const float4 near_root = (float4(0.0f) - half_b - sqrtd) / a;
+                const float4 far_root = (float4(0.0f) - half_b + sqrtd) / a;
+                const float4 near_ok = (near_root >= t_min) & (near_root <= best_t);
+                const float4 far_ok = (far_root >= t_min) & (far_root <= best_t);
+
+                const float4 root = Utils::select(near_ok, near_root, far_root);
+                const float4 closer = has_roots & (near_ok | far_ok);
+
+                best_t = Utils::select(closer, root, best_t);
+                best_index = Utils::select(closer, float4(static_cast<float>(i)), best_index);
+            }
+
+            alignas(16) float lane_t[RayPacket::width];
+            alignas(16) float lane_index[RayPacket::width];
+            best_t.store(lane_t);
+            best_index.store(lane_index);
+
+            for (int lane = 0; lane < RayPacket::width; lane++)
+            {
+                if (lane_index[lane] < 0.0f)
+                    continue;
+
+                hits.t[lane] = lane_t[lane];
+                hits.rec[lane] = make_record(rays.get(lane), static_cast<uint32_t>(lane_index[lane]), lane_t[lane]);
+            }
+        }
+
+        AABB bounds() const override
+        {
+            return box;
+        }
+    };
+}
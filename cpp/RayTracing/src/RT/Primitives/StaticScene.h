@@ -0,0 +1,152 @@
+#pragma once
+#include <tuple>
+#include <vector>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include "Hittable.h"
+#include "HitVector.h"
+
+
+namespace Primitives
+{
+    namespace detail
+    {
+        // primitive can report hit distance without building Record (`distance` + `record`)
+        template <typename T, typename = void>
+        struct has_distance : std::false_type {};
+
+        template <typename T>
+        struct has_distance<T, std::void_t<decltype(std::declval<const T&>().distance(std::declval<const ray&>(), 0.0f, 0.0f))>> : std::true_type {};
+    }
+
+    /// <summary>
+    /// Scene made of primitive types known at compile time. Every type is stored contiguously by value
+    /// and intersected with non-virtual (inlinable) calls, only the outer `IHittable` interface is virtual.
+    /// Primitives with `distance` are tested without building `Record`, it is built once for the closest hit of each type.
+    /// </summary>
+    template <typename... Ts>
+    class StaticScene : public IHittable
+    {
+        std::tuple<std::vector<Ts>...> objects;
+
+        template <typename T>
+        void intersect_all(const ray& r, float min, float& t, std::optional<Record>& hit) const
+        {
+            const auto& list = std::get<std::vector<T>>(objects);
+
+            if constexpr (detail::has_distance<T>::value)
+            {
+                const T* closest = nullptr;
+                for (const T& obj : list)
+                {
+                    const float d = obj.T::distance(r, min, t);
+                    if (d != std::numeric_limits<float>::infinity())
+                    {
+                        t = d;
+                        closest = &obj;
+                    }
+                }
+                if (closest != nullptr)
+                    hit = closest->T::record(r, t);
+            }
+            else
+            {
+                for (const T& obj : list)
+                {
+                    if (auto result = obj.T::intersect(r, min, t))
+                    {
+                        t = result->dis;
+                        hit = result;
+                    }
+                }
+            }
+        }
+
+        template <typename T>
+        void intersect_packet_all(const RayPacket& rays, float min, HitPacket& hits) const
+        {
+            for (const T& obj : std::get<std::vector<T>>(objects))
+                obj.T::intersect_packet(rays, min, hits);
+        }
+
+        template <typename T>
+        static bool is(const IHittable* obj)
+        {
+            return dynamic_cast<const T*>(obj) != nullptr;
+        }
+
+        template <typename T>
+        bool take(IHittable* obj)
+        {
+            if (T* typed = dynamic_cast<T*>(obj))
+            {
+                std::get<std::vector<T>>(objects).push_back(std::move(*typed));
+                return true;
+            }
+            return false;
+        }
+
+    public:
+        template <typename T>
+        void add(T object)
+        {
+            std::get<std::vector<T>>(objects).push_back(std::move(object));
+        }
+
+        template <typename T>
+        const std::vector<T>& get() const
+        {
+            return std::get<std::vector<T>>(objects);
+        }
+
+        size_t size() const
+        {
+            return (std::get<std::vector<Ts>>(objects).size() + ...);
+        }
+
+        /// <summary>
+        /// Moves objects of `source` into static scene. Returns nullopt and leaves `source` untouched
+        /// if any object is not one of `Ts`.
+        /// </summary>
+        static std::optional<StaticScene> from(HitVector& source)
+        {
+            for (const auto& obj : source)
+            {
+                if (!(is<Ts>(obj.get()) || ...))
+                    return {};
+            }
+
+            StaticScene scene;
+            for (auto& obj : source)
+                (scene.take<Ts>(obj.get()) || ...);
+            source.clear();
+            return scene;
+        }
+
+        std::optional<Record> intersect(const ray& r, float min, float max) const override
+        {
+            float t = max;
+            std::optional<Record> hit = std::nullopt;
+            (intersect_all<Ts>(r, min, t, hit), ...);
+            return hit;
+        }
+
+        void intersect_packet(const RayPacket& rays, float min, HitPacket& hits) const override
+        {
+            (intersect_packet_all<Ts>(rays, min, hits), ...);
+        }
+
+        AABB bounds() const override
+        {
+            AABB box;
+            auto grow = [&box](const auto& list)
+            {
+                for (const auto& obj : list)
+                    box.grow(obj.bounds());
+            };
+            (grow(std::get<std::vector<Ts>>(objects)), ...);
+            return box;
+        }
+    };
+}
@@ -0,0 +1,49 @@
+#include "TLAS.h"
+
+uint32_t Primitives::TLAS::add(Instance instance)
+{
+    instances.push_back(std::move(instance));
+    return static_cast<uint32_t>(instances.size() - 1);
+}
+
+void Primitives::TLAS::set_transform(uint32_t index, const glm::mat4& transform)
+{
+    instances[index].set_transform(transform);
+}
+
+void Primitives::TLAS::build()
+{
+    std::vector<BVH::BuildItem> items;
+    items.reserve(instances.size());
+    for (uint32_t i = 0; i < instances.size(); i++)
+    {
+        const AABB box = instances[i].bounds();
+        items.push_back({ box, box.centroid(), i });
+    }
+
+    nodes = BVH::build(items, leaf_size);
+
+    order.resize(items.size());
+    for (size_t i = 0; i < items.size(); i++)
+        order[i] = items[i].index;
+}
+
+std::optional<Primitives::Record> Primitives::TLAS::intersect(const ray& r, float min, float max) const
+{
+    float t = max;
+    std::optional<Record> hit = std::nullopt;
+
+    BVH::traverse(nodes.data(), nodes.size(), r, min, t, [&](const BVH::Node& node, float& closest)
+        {
+            for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+            {
+                if (auto result = instances[order[i]].Instance::intersect(r, min, closest))
+                {
+                    closest = result->dis;
+                    hit = result;
+                }
+            }
+        });
+
+    return hit;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Hittable.h"
+#include "Instance.h"
+#include "BVH.h"
+
+
+namespace Primitives
+{
+    /// <summary>
+    /// Top level acceleration structure - BVH over instances of shared objects. Objects keep their own
+    /// acceleration structures, so moving instances only requires `build` of this (small) tree.
+    /// Instances are stored by value and intersected without virtual call, only objects they reference are virtual.
+    /// </summary>
+    class TLAS : public IHittable
+    {
+        std::vector<Instance> instances;
+        // leaves reference ranges of `order`, which holds indices into `instances`
+        std::vector<uint32_t> order;
+        std::vector<BVH::Node> nodes;
+
+    public:
+        static constexpr uint32_t leaf_size = 2;
+
+        /// <summary>
+        /// Adds instance and returns its index, takes effect after `build`
+        /// </summary>
+        uint32_t add(Instance instance);
+
+        /// <summary>
+        /// Moves instance `index`, takes effect after `build`
+        /// </summary>
+        void set_transform(uint32_t index, const glm::mat4& transform);
+
+        const Instance& operator[](uint32_t index) const { return instances[index]; }
+        size_t size() const { return instances.size(); }
+        size_t node_count() const { return nodes.size(); }
+
+        /// <summary>
+        /// Rebuilds tree over current instance bounds. Has to be called after changes and before tracing,
+        /// must not run while other threads trace this structure.
+        /// </summary>
+        void build();
+
+        std::optional<Record> intersect(const ray& r, float min, float max) const override;
+
+        AABB bounds() const override
+        {
+            return nodes.empty() ? AABB() : nodes[0].box;
+        }
+    };
+}
@@ -0,0 +1,245 @@
+#include "TriangleMesh.h"
+#include <cmath>
+#include <algorithm>
+#include "../../Utils/Simd.h"
+
+namespace
+{
+    // arrays of mesh built in memory, referenced by TriangleMesh::Buffers
+    struct Storage
+    {
+        std::vector<float> px, py, pz;
+        std::vector<float> nx, ny, nz;
+        std::vector<uint32_t> indices;
+        std::vector<uint32_t> normal_indices;
+        std::vector<Primitives::BVH::Node> nodes;
+    };
+}
+
+Primitives::TriangleMesh::TriangleMesh(const MeshData& data, uint32_t material) : mat(material)
+{
+    auto owned = std::make_shared<Storage>();
+    const size_t vertices = data.positions.size();
+    const size_t triangles = data.triangle_count();
+
+    owned->px.resize(vertices);
+    owned->py.resize(vertices);
+    owned->pz.resize(vertices);
+    for (size_t i = 0; i < vertices; i++)
+    {
+        owned->px[i] = data.positions[i].x;
+        owned->py[i] = data.positions[i].y;
+        owned->pz[i] = data.positions[i].z;
+    }
+
+    owned->nx.resize(data.normals.size());
+    owned->ny.resize(data.normals.size());
+    owned->nz.resize(data.normals.size());
+    for (size_t i = 0; i < data.normals.size(); i++)
+    {
+        const auto n = glm::normalize(data.normals[i]);
+        owned->nx[i] = n.x;
+        owned->ny[i] = n.y;
+        owned->nz[i] = n.z;
+    }
+
+    std::vector<BVH::BuildItem> items;
+    items.reserve(triangles);
+    for (uint32_t i = 0; i < triangles; i++)
+    {
+        AABB box;
+        for (int k = 0; k < 3; k++)
+            box.grow(data.positions[data.indices[3 * i + k]]);
+        items.push_back({ box, box.centroid(), i });
+    }
+
+    owned->nodes = BVH::build(items, leaf_size);
+
+    // leaves reference triangles by position in `items`, so store triangles in that order
+    const bool has_normals = !data.normal_indices.empty() && !data.normals.empty();
+    owned->indices.resize(3 * triangles);
+    if (has_normals)
+        owned->normal_indices.resize(3 * triangles);
+
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        const size_t source = items[i].index;
+        for (int k = 0; k < 3; k++)
+        {
+            owned->indices[3 * i + k] = data.indices[3 * source + k];
+            if (has_normals)
+                owned->normal_indices[3 * i + k] = data.normal_indices[3 * source + k];
+        }
+    }
+
+    buf = { owned->px.data(), owned->py.data(), owned->pz.data(), owned->nx.data(), owned->ny.data(), owned->nz.data(),
+        owned->indices.data(), has_normals ? owned->normal_indices.data() : nullptr, owned->nodes.data(),
+        vertices, data.normals.size(), triangles, owned->nodes.size() };
+    storage = std::move(owned);
+}
+
+Primitives::TriangleMesh::Watertight::Watertight(const glm::vec3& dir)
+{
+    const glm::vec3 a = glm::abs(dir);
+    kz = a.x > a.y ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+    kx = kz == 2 ? 0 : kz + 1;
+    ky = kx == 2 ? 0 : kx + 1;
+    // keeps winding of transformed triangle
+    if (dir[kz] < 0.0f)
+        std::swap(kx, ky);
+
+    sx = dir[kx] / dir[kz];
+    sy = dir[ky] / dir[kz];
+    sz = 1.0f / dir[kz];
+}
+
+void Primitives::TriangleMesh::intersect_leaf(const ray& r, const Watertight& w, uint32_t first, uint32_t count, float min, float& t, Hit& hit) const
+{
+    using Utils::float4;
+
+    const float* axis[3] = { buf.px, buf.py, buf.pz };
+    const float* ax = axis[w.kx];
+    const float* ay = axis[w.ky];
+    const float* az = axis[w.kz];
+    const float ox = r.origin[w.kx];
+    const float oy = r.origin[w.ky];
+    const float oz = r.origin[w.kz];
+
+    const float4 sx(w.sx), sy(w.sy), sz(w.sz), zero(0.0f);
+
+    for (uint32_t base = first; base < first + count; base += 4)
+    {
+        const uint32_t lanes = std::min(4u, first + count - base);
+
+        // vertex, axis, lane - missing lanes repeat last triangle and are masked out later
+        alignas(16) float v[3][3][4];
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            const uint32_t tri = base + std::min(lane, lanes - 1);
+            for (int k = 0; k < 3; k++)
+            {
+                const uint32_t index = buf.indices[3 * tri + k];
+                v[k][0][lane] = ax[index] - ox;
+                v[k][1][lane] = ay[index] - oy;
+                v[k][2][lane] = az[index] - oz;
+            }
+        }
+
+        // shear so that ray points along +z and starts in origin
+        const float4 az0 = float4::load(v[0][2]), az1 = float4::load(v[1][2]), az2 = float4::load(v[2][2]);
+        const float4 x0 = float4::load(v[0][0]) - sx * az0, y0 = float4::load(v[0][1]) - sy * az0;
+        const float4 x1 = float4::load(v[1][0]) - sx * az1, y1 = float4::load(v[1][1]) - sy * az1;
+        const float4 x2 = float4::load(v[2][0]) - sx * az2, y2 = float4::load(v[2][1]) - sy * az2;
+
+        // scaled barycentrics as 2D edge functions
+        float4 u = x2 * y1 - y2 * x1;
+        float4 vv = x0 * y2 - y0 * x2;
+        float4 ww = x1 * y0 - y1 * x0;
+
+        auto is_zero = [&](float4 f) { return (f >= zero) & (f <= zero); };
+        int fallback = Utils::movemask(is_zero(u) | is_zero(vv) | is_zero(ww)) & ((1 << lanes) - 1);
+
+        // ray passes exactly through edge, float edge functions cannot tell on which side - redo them in double
+        if (fallback)
+        {
+            alignas(16) float fu[4], fv[4], fw[4], f[6][4];
+            u.store(fu);
+            vv.store(fv);
+            ww.store(fw);
+            x0.store(f[0]); y0.store(f[1]);
+            x1.store(f[2]); y1.store(f[3]);
+            x2.store(f[4]); y2.store(f[5]);
+
+            for (int lane = 0; lane < 4; lane++)
+            {
+                if ((fallback >> lane & 1) == 0)
+                    continue;
+                const double dx0 = f[0][lane], dy0 = f[1][lane], dx1 = f[2][lane], dy1 = f[3][lane], dx2 = f[4][lane], dy2 = f[5][lane];
+                fu[lane] = static_cast<float>(dx2 * dy1 - dy2 * dx1);
+                fv[lane] = static_cast<float>(dx0 * dy2 - dy0 * dx2);
+                fw[lane] = static_cast<float>(dx1 * dy0 - dy1 * dx0);
+            }
+
+            u = float4::load(fu);
+            vv = float4::load(fv);
+            ww = float4::load(fw);
+        }
+
+        const float4 negative = (u < zero) | (vv < zero) | (ww < zero);
+        const float4 positive = (u > zero) | (vv > zero) | (ww > zero);
+
+        const float4 det = u + vv + ww;
+        const float4 dist = (u * az0 + vv * az1 + ww * az2) * sz / det;
+
+        // det == 0 gives NaN or infinity, both fail the range test
+        int mask = ~Utils::movemask(negative & positive) & Utils::movemask((dist > float4(min)) & (dist < float4(t)));
+        mask &= (1 << lanes) - 1;
+        if (mask == 0)
+            continue;
+
+        alignas(16) float fd[4], fdet[4], fu[4], fv[4], fw[4];
+        dist.store(fd);
+        det.store(fdet);
+        u.store(fu);
+        vv.store(fv);
+        ww.store(fw);
+
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if ((mask >> lane & 1) == 0 || fd[lane] >= t)
+                continue;
+            const float inv = 1.0f / fdet[lane];
+            t = fd[lane];
+            hit = { base + lane, fd[lane], fu[lane] * inv, fv[lane] * inv, fw[lane] * inv };
+        }
+    }
+}
+
+Primitives::Record Primitives::TriangleMesh::make_record(const ray& r, const Hit& hit) const
+{
+    const uint32_t* tri = &buf.indices[3 * hit.triangle];
+    auto position = [&](uint32_t i) { return glm::vec3(buf.px[i], buf.py[i], buf.pz[i]); };
+
+    const glm::vec3 p0 = position(tri[0]);
+    const glm::vec3 p1 = position(tri[1]);
+    const glm::vec3 p2 = position(tri[2]);
+
+    glm::vec3 norm = glm::cross(p1 - p0, p2 - p0);
+
+    if (buf.normal_indices != nullptr)
+    {
+        const uint32_t* n = &buf.normal_indices[3 * hit.triangle];
+        if (n[0] != MeshData::no_normal && n[1] != MeshData::no_normal && n[2] != MeshData::no_normal)
+        {
+            auto normal = [&](uint32_t i) { return glm::vec3(buf.nx[i], buf.ny[i], buf.nz[i]); };
+            const glm::vec3 shading = normal(n[0]) * hit.b0 + normal(n[1]) * hit.b1 + normal(n[2]) * hit.b2;
+            // keep geometric normal where interpolation cancels out
+            if (Utils::Vec3::sqr_lenght(shading) > 1e-12f)
+                norm = shading;
+        }
+    }
+
+    const glm::vec3 pos = p0 * hit.b0 + p1 * hit.b1 + p2 * hit.b2;
+    return Record::from(pos, glm::normalize(norm), hit.t, r, mat);
+}
+
+std::optional<Primitives::Record> Primitives::TriangleMesh::intersect(const ray& r, float min, float max) const
+{
+    const Watertight w(r.dir);
+
+    float t = max;
+    Hit hit{};
+    bool found = false;
+
+    BVH::traverse(buf.nodes, buf.node_count, r, min, t, [&](const BVH::Node& node, float& closest)
+        {
+            const float before = closest;
+            intersect_leaf(r, w, node.offset, node.count, min, closest, hit);
+            found |= closest < before;
+        });
+
+    if (!found)
+        return std::nullopt;
+
+    return make_record(r, hit);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <glm.hpp>
+#include "Hittable.h"
+#include "BVH.h"
+
+
+namespace Primitives
+{
+    /// <summary>
+    /// Mesh as loaded from file - vertex attributes with own index buffers, 3 indices per triangle.
+    /// `normal_indices` is either empty or has one entry per position index, `no_normal` marks triangles without normals.
+    /// </summary>
+    struct MeshData
+    {
+        static constexpr uint32_t no_normal = 0xFFFFFFFFu;
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<uint32_t> indices;
+        std::vector<uint32_t> normal_indices;
+
+        size_t triangle_count() const { return indices.size() / 3; }
+
+        AABB bounds() const
+        {
+            AABB box;
+            for (const auto& p : positions)
+                box.grow(p);
+            return box;
+        }
+    };
+
+    /// <summary>
+    /// Indexed triangle mesh with its own BVH. Positions and normals are shared SoA buffers referenced by index,
+    /// triangles are reordered so every leaf is contiguous run of at most `leaf_size` triangles,
+    /// which are tested against ray at once by watertight ray/triangle test (Woop, Benthin, Wald 2013).
+    /// Buffers are only referenced, they live in storage shared by copies of mesh (own vectors or mapped scene file).
+    /// </summary>
+    class TriangleMesh : public IHittable
+    {
+    public:
+        /// <summary>
+        /// Views of mesh arrays. `normal_indices` is nullptr if mesh has no normals, otherwise it has one entry per index.
+        /// </summary>
+        struct Buffers
+        {
+            const float* px = nullptr;
+            const float* py = nullptr;
+            const float* pz = nullptr;
+            const float* nx = nullptr;
+            const float* ny = nullptr;
+            const float* nz = nullptr;
+            const uint32_t* indices = nullptr;
+            const uint32_t* normal_indices = nullptr;
+            const BVH::Node* nodes = nullptr;
+
+            size_t vertices = 0;
+            size_t normals = 0;
+            size_t triangles = 0;
+            size_t node_count = 0;
+        };
+
+    private:
+        Buffers buf;
+        std::shared_ptr<const void> storage;
+        uint32_t mat = 0;
+
+        // ray transformed so that it points along +z, shared by all triangles it is tested against
+        struct Watertight
+        {
+            int kx, ky, kz;
+            float sx, sy, sz;
+
+            explicit Watertight(const glm::vec3& dir);
+        };
+
+        struct Hit
+        {
+            uint32_t triangle;
+            float t, b0, b1, b2;
+        };
+
+        void intersect_leaf(const ray& r, const Watertight& w, uint32_t first, uint32_t count, float min, float& t, Hit& hit) const;
+        Record make_record(const ray& r, const Hit& hit) const;
+
+    public:
+        static constexpr uint32_t leaf_size = 4;
+
+        TriangleMesh() = default;
+
+        /// <summary>
+        /// Builds mesh from `data` (indices must be valid), every triangle uses material `material`
+        /// </summary>
+        TriangleMesh(const MeshData& data, uint32_t material);
+
+        /// <summary>
+        /// Mesh over already built buffers (eg. mapped from scene file), `owner` keeps them alive
+        /// </summary>
+        TriangleMesh(const Buffers& buffers, std::shared_ptr<const void> owner, uint32_t material)
+            : buf(buffers), storage(std::move(owner)), mat(material) {}
+
+        const Buffers& buffers() const { return buf; }
+        uint32_t material() const { return mat; }
+
+        size_t triangle_count() const { return buf.triangles; }
+        size_t vertex_count() const { return buf.vertices; }
+        size_t node_count() const { return buf.node_count; }
+
+        std::optional<Record> intersect(const ray& r, float min, float max) const override;
+
+        AABB bounds() const override
+        {
+            return buf.node_count == 0 ? AABB() : buf.nodes[0].box;
+        }
+    };
+}
@@ -0,0 +1,817 @@
+#include "MeshLoader.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "../../Utils/MappedFile.h"
+#include "../../Utils/thread_pool.hpp"
+
+using Primitives::MeshData;
+
+namespace
+{
+    // smaller pieces of file are not worth separate task
+    constexpr size_t min_chunk_size = 1 << 20;
+
+    size_t worker_count()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char* skip_spaces(const char* p, const char* end)
+    {
+        while (p < end && is_space(*p))
+            p++;
+        return p;
+    }
+
+    const char* line_end(const char* p, const char* end)
+    {
+        const void* nl = std::memchr(p, '\n', end - p);
+        return nl ? static_cast<const char*>(nl) : end;
+    }
+
+    // from_chars does not accept leading '+'
+    template <typename T>
+    bool parse_number(const char*& p, const char* end, T& out)
+    {
+        p = skip_spaces(p, end);
+        if (p < end && *p == '+')
+            p++;
+        const auto [next, ec] = std::from_chars(p, end, out);
+        if (ec != std::errc())
+            return false;
+        p = next;
+        return true;
+    }
+
+    /// <summary>
+    /// Splits [from, size) into about `parts` ranges, every range ends after newline (or at end of data)
+    /// </summary>
+    std::vector<std::pair<size_t, size_t>> split_lines(const char* data, size_t from, size_t size, size_t parts)
+    {
+        std::vector<std::pair<size_t, size_t>> ranges;
+        size_t begin = from;
+        for (size_t i = 1; i <= parts && begin < size; i++)
+        {
+            size_t end = i == parts ? size : std::max(begin, from + (size - from) * i / parts);
+            if (end < size)
+                end = line_end(data + end, data + size) - data + 1;
+            end = std::min(end, size);
+            if (end > begin)
+                ranges.push_back({ begin, end });
+            begin = end;
+        }
+        return ranges;
+    }
+
+    size_t chunk_count(size_t bytes)
+    {
+        return std::clamp<size_t>(bytes / min_chunk_size, 1, worker_count() * 4);
+    }
+
+    // ---------------------------------------------------------------- OBJ
+
+    constexpr int64_t no_index = INT64_MIN;
+
+    /// <summary>
+    /// Part of .obj file parsed independently of others. Indices are 0 based, negative (relative) indices
+    /// cannot be resolved before vertex counts of preceding chunks are known, so they are stored relative
+    /// to first vertex of chunk and their slots are listed in `relative_*`.
+    /// </summary>
+    struct ObjChunk
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<int64_t> indices;
+        std::vector<int64_t> normal_indices;
+        std::vector<size_t> relative_positions;
+        std::vector<size_t> relative_normals;
+        bool has_normals = false;
+
+        size_t lines = 0;
+        std::string error;
+    };
+
+    bool parse_vec3(const char* p, const char* end, glm::vec3& out)
+    {
+        return parse_number(p, end, out.x) && parse_number(p, end, out.y) && parse_number(p, end, out.z);
+    }
+
+    // "v", "v/vt", "v//vn" or "v/vt/vn", `vn` is left untouched if missing
+    bool parse_face_vertex(const char*& p, const char* end, int64_t& v, int64_t& vn)
+    {
+        if (!parse_number(p, end, v) || v == 0)
+            return false;
+        if (p < end && *p == '/')
+        {
+            p++;
+            int64_t vt;
+            if (p < end && *p != '/' && !parse_number(p, end, vt))
+                return false;
+            if (p < end && *p == '/')
+            {
+                p++;
+                if (!parse_number(p, end, vn) || vn == 0)
+                    return false;
+            }
+        }
+        return p == end || is_space(*p);
+    }
+
+    void parse_obj_chunk(const char* p, const char* end, ObjChunk& chunk)
+    {
+        std::vector<int64_t> face_v, face_n;
+
+        // 1 based positive index is absolute, negative counts back from last vertex read so far
+        auto resolve = [](int64_t index, size_t count, std::vector<size_t>& relative, size_t slot)
+        {
+            if (index > 0)
+                return index - 1;
+            relative.push_back(slot);
+            return static_cast<int64_t>(count) + index;
+        };
+
+        while (p < end)
+        {
+            const char* eol = line_end(p, end);
+            const char* s = skip_spaces(p, eol);
+            p = eol + 1;
+            chunk.lines++;
+
+            const size_t length = eol - s;
+            if (length >= 2 && s[0] == 'v' && is_space(s[1]))
+            {
+                glm::vec3 v;
+                if (!parse_vec3(s + 1, eol, v))
+                {
+                    chunk.error = "invalid vertex position";
+                    return;
+                }
+                chunk.positions.push_back(v);
+            }
+            else if (length >= 3 && s[0] == 'v' && s[1] == 'n' && is_space(s[2]))
+            {
+                glm::vec3 n;
+                if (!parse_vec3(s + 2, eol, n))
+                {
+                    chunk.error = "invalid vertex normal";
+                    return;
+                }
+                chunk.normals.push_back(n);
+            }
+            else if (length >= 2 && s[0] == 'f' && is_space(s[1]))
+            {
+                face_v.clear();
+                face_n.clear();
+                for (s++;;)
+                {
+                    s = skip_spaces(s, eol);
+                    if (s == eol || *s == '#')
+                        break;
+                    int64_t v, vn = no_index;
+                    if (!parse_face_vertex(s, eol, v, vn))
+                    {
+                        chunk.error = "invalid face index";
+                        return;
+                    }
+                    face_v.push_back(v);
+                    face_n.push_back(vn);
+                }
+
+                if (face_v.size() < 3)
+                {
+                    chunk.error = "face has less than 3 vertices";
+                    return;
+                }
+
+                for (size_t k = 1; k + 1 < face_v.size(); k++)
+                {
+                    for (const size_t j : { size_t(0), k, k + 1 })
+                    {
+                        const size_t slot = chunk.indices.size();
+                        chunk.indices.push_back(resolve(face_v[j], chunk.positions.size(), chunk.relative_positions, slot));
+                        if (face_n[j] == no_index)
+                        {
+                            chunk.normal_indices.push_back(no_index);
+                            continue;
+                        }
+                        chunk.normal_indices.push_back(resolve(face_n[j], chunk.normals.size(), chunk.relative_normals, slot));
+                        chunk.has_normals = true;
+                    }
+                }
+            }
+            // texture coordinates, groups, materials, lines and comments are ignored
+        }
+    }
+
+    std::optional<MeshData> load_obj(const Utils::MappedFile& file, const std::string& path, std::string& error)
+    {
+        const char* data = file.data();
+        const auto ranges = split_lines(data, 0, file.size(), chunk_count(file.size()));
+        std::vector<ObjChunk> chunks(ranges.size());
+
+        thread_pool pool(static_cast<uint32_t>(worker_count()));
+        pool.parallelize_loop(size_t(0), chunks.size(), [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                    parse_obj_chunk(data + ranges[i].first, data + ranges[i].second, chunks[i]);
+            }, static_cast<uint32_t>(chunks.size()));
+
+        // prefix sums give every chunk its place in merged buffers
+        std::vector<size_t> position_base(chunks.size() + 1, 0), normal_base(chunks.size() + 1, 0), index_base(chunks.size() + 1, 0);
+        size_t line = 0;
+        bool has_normals = false;
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            const auto& chunk = chunks[i];
+            if (!chunk.error.empty())
+            {
+                error = path + ":" + std::to_string(line + chunk.lines) + ": " + chunk.error;
+                return {};
+            }
+            line += chunk.lines;
+            has_normals |= chunk.has_normals;
+            position_base[i + 1] = position_base[i] + chunk.positions.size();
+            normal_base[i + 1] = normal_base[i] + chunk.normals.size();
+            index_base[i + 1] = index_base[i] + chunk.indices.size();
+        }
+
+        MeshData mesh;
+        mesh.positions.resize(position_base.back());
+        mesh.normals.resize(normal_base.back());
+        mesh.indices.resize(index_base.back());
+        if (has_normals)
+            mesh.normal_indices.resize(index_base.back());
+
+        const int64_t positions = static_cast<int64_t>(mesh.positions.size());
+        const int64_t normals = static_cast<int64_t>(mesh.normals.size());
+        std::atomic<bool> invalid = false;
+
+        if (positions >= int64_t(MeshData::no_normal) || normals >= int64_t(MeshData::no_normal))
+        {
+            error = path + ": too many vertices";
+            return {};
+        }
+
+        pool.parallelize_loop(size_t(0), chunks.size(), [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    auto& chunk = chunks[i];
+                    std::copy(chunk.positions.begin(), chunk.positions.end(), mesh.positions.begin() + position_base[i]);
+                    std::copy(chunk.normals.begin(), chunk.normals.end(), mesh.normals.begin() + normal_base[i]);
+
+                    for (const size_t slot : chunk.relative_positions)
+                        chunk.indices[slot] += position_base[i];
+                    for (const size_t slot : chunk.relative_normals)
+                        chunk.normal_indices[slot] += normal_base[i];
+
+                    for (size_t k = 0; k < chunk.indices.size(); k++)
+                    {
+                        const int64_t v = chunk.indices[k];
+                        const int64_t n = chunk.normal_indices[k];
+                        if (v < 0 || v >= positions || (n != no_index && (n < 0 || n >= normals)))
+                        {
+                            invalid = true;
+                            break;
+                        }
+                        mesh.indices[index_base[i] + k] = static_cast<uint32_t>(v);
+                        if (has_normals)
+                            mesh.normal_indices[index_base[i] + k] = n == no_index ? MeshData::no_normal : static_cast<uint32_t>(n);
+                    }
+
+                    // release chunk memory early, merged mesh already holds copy
+                    chunk = ObjChunk();
+                }
+            }, static_cast<uint32_t>(chunks.size()));
+
+        if (invalid)
+        {
+            error = path + ": face references vertex or normal that does not exist";
+            return {};
+        }
+
+        return mesh;
+    }
+
+    // ---------------------------------------------------------------- PLY
+
+    enum class PlyType
+    {
+        Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64,
+    };
+
+    std::optional<PlyType> ply_type(const std::string& name)
+    {
+        if (name == "char" || name == "int8") return PlyType::Int8;
+        if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+        if (name == "short" || name == "int16") return PlyType::Int16;
+        if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+        if (name == "int" || name == "int32") return PlyType::Int32;
+        if (name == "uint" || name == "uint32") return PlyType::UInt32;
+        if (name == "float" || name == "float32") return PlyType::Float32;
+        if (name == "double" || name == "float64") return PlyType::Float64;
+        return {};
+    }
+
+    size_t size_of(PlyType type)
+    {
+        switch (type)
+        {
+        case PlyType::Int8: case PlyType::UInt8: return 1;
+        case PlyType::Int16: case PlyType::UInt16: return 2;
+        case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+        default: return 8;
+        }
+    }
+
+    // little endian value of `type` at `p`
+    double read_binary(const char* p, PlyType type)
+    {
+        switch (type)
+        {
+        case PlyType::Int8: { int8_t v; std::memcpy(&v, p, 1); return v; }
+        case PlyType::UInt8: { uint8_t v; std::memcpy(&v, p, 1); return v; }
+        case PlyType::Int16: { int16_t v; std::memcpy(&v, p, 2); return v; }
+        case PlyType::UInt16: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+        case PlyType::Int32: { int32_t v; std::memcpy(&v, p, 4); return v; }
+        case PlyType::UInt32: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+        case PlyType::Float32: { float v; std::memcpy(&v, p, 4); return v; }
+        default: { double v; std::memcpy(&v, p, 8); return v; }
+        }
+    }
+
+    struct PlyProperty
+    {
+        std::string name;
+        PlyType type;
+        bool list = false;
+        PlyType count_type = PlyType::UInt8;
+    };
+
+    struct PlyElement
+    {
+        std::string name;
+        size_t count = 0;
+        std::vector<PlyProperty> properties;
+
+        int find(const std::string& property) const
+        {
+            for (size_t i = 0; i < properties.size(); i++)
+                if (properties[i].name == property)
+                    return static_cast<int>(i);
+            return -1;
+        }
+
+        // record size in binary file, 0 if element has list properties
+        size_t stride() const
+        {
+            size_t size = 0;
+            for (const auto& p : properties)
+            {
+                if (p.list)
+                    return 0;
+                size += size_of(p.type);
+            }
+            return size;
+        }
+    };
+
+    struct PlyHeader
+    {
+        bool binary = false;
+        std::vector<PlyElement> elements;
+        size_t body = 0;
+    };
+
+    std::optional<PlyHeader> parse_ply_header(const char* data, size_t size, std::string& error)
+    {
+        PlyHeader header;
+        const char* p = data;
+        const char* end = data + size;
+        bool first = true;
+
+        while (p < end)
+        {
+            const char* eol = line_end(p, end);
+            std::string line(p, eol);
+            p = eol + 1;
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            std::vector<std::string> words;
+            for (size_t i = 0; i < line.size();)
+            {
+                while (i < line.size() && is_space(line[i]))
+                    i++;
+                const size_t start = i;
+                while (i < line.size() && !is_space(line[i]))
+                    i++;
+                if (i > start)
+                    words.push_back(line.substr(start, i - start));
+            }
+
+            if (first)
+            {
+                if (words.size() != 1 || words[0] != "ply")
+                {
+                    error = "missing ply magic";
+                    return {};
+                }
+                first = false;
+                continue;
+            }
+
+            if (words.empty() || words[0] == "comment" || words[0] == "obj_info")
+                continue;
+
+            if (words[0] == "end_header")
+            {
+                header.body = p - data;
+                return header;
+            }
+
+            if (words[0] == "format" && words.size() >= 2)
+            {
+                if (words[1] == "binary_little_endian")
+                    header.binary = true;
+                else if (words[1] != "ascii")
+                {
+                    error = "unsupported format " + words[1];
+                    return {};
+                }
+            }
+            else if (words[0] == "element" && words.size() == 3)
+            {
+                size_t count = 0;
+                const char* digits = words[2].c_str();
+                if (!parse_number(digits, digits + words[2].size(), count))
+                {
+                    error = "invalid element count: " + line;
+                    return {};
+                }
+                header.elements.push_back({ words[1], count, {} });
+            }
+            else if (words[0] == "property" && !header.elements.empty())
+            {
+                PlyProperty property;
+                std::optional<PlyType> type, count_type = PlyType::UInt8;
+                if (words.size() == 5 && words[1] == "list")
+                {
+                    property.list = true;
+                    count_type = ply_type(words[2]);
+                    type = ply_type(words[3]);
+                    property.name = words[4];
+                }
+                else if (words.size() == 3)
+                {
+                    type = ply_type(words[1]);
+                    property.name = words[2];
+                }
+
+                if (!type || !count_type)
+                {
+                    error = "invalid property: " + line;
+                    return {};
+                }
+                property.type = *type;
+                property.count_type = *count_type;
+                header.elements.back().properties.push_back(property);
+            }
+            else
+            {
+                error = "invalid header line: " + line;
+                return {};
+            }
+        }
+
+        error = "missing end_header";
+        return {};
+    }
+
+    // property slots of vertex element used by mesh, -1 if missing
+    struct VertexLayout
+    {
+        int position[3];
+        int normal[3];
+
+        explicit VertexLayout(const PlyElement& vertex)
+        {
+            position[0] = vertex.find("x");
+            position[1] = vertex.find("y");
+            position[2] = vertex.find("z");
+            normal[0] = vertex.find("nx");
+            normal[1] = vertex.find("ny");
+            normal[2] = vertex.find("nz");
+        }
+
+        bool has_normals() const { return normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0; }
+    };
+
+    int face_list(const PlyElement& face)
+    {
+        const int index = face.find("vertex_indices");
+        return index >= 0 ? index : face.find("vertex_index");
+    }
+
+    void triangulate(const std::vector<uint32_t>& polygon, std::vector<uint32_t>& indices)
+    {
+        for (size_t k = 1; k + 1 < polygon.size(); k++)
+        {
+            indices.push_back(polygon[0]);
+            indices.push_back(polygon[k]);
+            indices.push_back(polygon[k + 1]);
+        }
+    }
+
+    bool parse_ply_ascii(const char* p, const char* end, const PlyHeader& header, MeshData& mesh, std::string& error)
+    {
+        std::vector<double> values;
+        std::vector<uint32_t> polygon;
+
+        // numbers of one element may span lines, newline is just whitespace here
+        auto next = [&](double& value)
+        {
+            while (p < end && (is_space(*p) || *p == '\n'))
+                p++;
+            return parse_number(p, end, value);
+        };
+
+        for (const auto& element : header.elements)
+        {
+            const bool is_vertex = element.name == "vertex";
+            const bool is_face = element.name == "face";
+            const VertexLayout layout(element);
+            const int list = face_list(element);
+
+            for (size_t i = 0; i < element.count; i++)
+            {
+                values.assign(element.properties.size(), 0.0);
+                for (size_t k = 0; k < element.properties.size(); k++)
+                {
+                    const auto& property = element.properties[k];
+                    size_t count = 1;
+                    if (property.list)
+                    {
+                        double n;
+                        if (!next(n))
+                        {
+                            error = "invalid " + element.name + " list";
+                            return false;
+                        }
+                        count = static_cast<size_t>(n);
+                        polygon.clear();
+                    }
+
+                    for (size_t j = 0; j < count; j++)
+                    {
+                        double value;
+                        if (!next(value))
+                        {
+                            error = "invalid " + element.name + " value";
+                            return false;
+                        }
+                        values[k] = value;
+                        if (property.list && is_face && static_cast<int>(k) == list)
+                            polygon.push_back(static_cast<uint32_t>(value));
+                    }
+                }
+
+                if (is_vertex)
+                {
+                    auto vec = [&](const int* slots) { return glm::vec3(float(values[slots[0]]), float(values[slots[1]]), float(values[slots[2]])); };
+                    mesh.positions.push_back(vec(layout.position));
+                    if (layout.has_normals())
+                        mesh.normals.push_back(vec(layout.normal));
+                }
+                else if (is_face)
+                    triangulate(polygon, mesh.indices);
+            }
+        }
+        return true;
+    }
+
+    bool parse_ply_binary(const char* data, size_t size, const PlyHeader& header, MeshData& mesh, std::string& error)
+    {
+        thread_pool pool(static_cast<uint32_t>(worker_count()));
+        size_t offset = header.body;
+
+        auto truncated = [&]()
+        {
+            error = "unexpected end of file";
+            return false;
+        };
+
+        for (const auto& element : header.elements)
+        {
+            const size_t stride = element.stride();
+
+            if (element.name == "vertex")
+            {
+                if (stride == 0)
+                {
+                    error = "vertex element with list property";
+                    return false;
+                }
+                if (size - offset < element.count * stride)
+                    return truncated();
+
+                const VertexLayout layout(element);
+                std::vector<size_t> at(element.properties.size(), 0);
+                for (size_t k = 1; k < at.size(); k++)
+                    at[k] = at[k - 1] + size_of(element.properties[k - 1].type);
+
+                mesh.positions.resize(element.count);
+                if (layout.has_normals())
+                    mesh.normals.resize(element.count);
+
+                const char* base = data + offset;
+                pool.parallelize_loop(size_t(0), element.count, [&](size_t begin, size_t end)
+                    {
+                        auto read = [&](const char* record, int k)
+                        {
+                            return static_cast<float>(read_binary(record + at[k], element.properties[k].type));
+                        };
+                        for (size_t i = begin; i < end; i++)
+                        {
+                            const char* record = base + i * stride;
+                            mesh.positions[i] = { read(record, layout.position[0]), read(record, layout.position[1]), read(record, layout.position[2]) };
+                            if (layout.has_normals())
+                                mesh.normals[i] = { read(record, layout.normal[0]), read(record, layout.normal[1]), read(record, layout.normal[2]) };
+                        }
+                    });
+
+                offset += element.count * stride;
+                continue;
+            }
+
+            if (stride != 0)
+            {
+                if (size - offset < element.count * stride)
+                    return truncated();
+                offset += element.count * stride;
+                continue;
+            }
+
+            const int list = element.name == "face" ? face_list(element) : -1;
+
+            // Usual triangle-only face element has fixed record size, which lets threads decode it in place.
+            // If any record turns out to be other polygon fall through to sequential walk.
+            if (list >= 0 && element.properties.size() == 1)
+            {
+                const auto& property = element.properties[0];
+                const size_t count_size = size_of(property.count_type);
+                const size_t index_size = size_of(property.type);
+                const size_t record = count_size + 3 * index_size;
+
+                if (size - offset >= element.count * record)
+                {
+                    const char* base = data + offset;
+                    std::atomic<bool> mixed = false;
+                    mesh.indices.resize(3 * element.count);
+
+                    pool.parallelize_loop(size_t(0), element.count, [&](size_t begin, size_t end)
+                        {
+                            for (size_t i = begin; i < end && !mixed; i++)
+                            {
+                                const char* p = base + i * record;
+                                if (read_binary(p, property.count_type) != 3.0)
+                                {
+                                    mixed = true;
+                                    return;
+                                }
+                                for (int k = 0; k < 3; k++)
+                                    mesh.indices[3 * i + k] = static_cast<uint32_t>(read_binary(p + count_size + k * index_size, property.type));
+                            }
+                        });
+
+                    if (!mixed)
+                    {
+                        offset += element.count * record;
+                        continue;
+                    }
+                    mesh.indices.clear();
+                }
+            }
+
+            std::vector<uint32_t> polygon;
+            for (size_t i = 0; i < element.count; i++)
+            {
+                for (size_t k = 0; k < element.properties.size(); k++)
+                {
+                    const auto& property = element.properties[k];
+                    size_t count = 1;
+                    if (property.list)
+                    {
+                        if (size - offset < size_of(property.count_type))
+                            return truncated();
+                        count = static_cast<size_t>(read_binary(data + offset, property.count_type));
+                        offset += size_of(property.count_type);
+                    }
+
+                    const size_t bytes = count * size_of(property.type);
+                    if (size - offset < bytes)
+                        return truncated();
+
+                    if (static_cast<int>(k) == list)
+                    {
+                        polygon.clear();
+                        for (size_t j = 0; j < count; j++)
+                            polygon.push_back(static_cast<uint32_t>(read_binary(data + offset + j * size_of(property.type), property.type)));
+                        triangulate(polygon, mesh.indices);
+                    }
+                    offset += bytes;
+                }
+            }
+        }
+        return true;
+    }
+
+    std::optional<MeshData> load_ply(const Utils::MappedFile& file, const std::string& path, std::string& error)
+    {
+        auto header = parse_ply_header(file.data(), file.size(), error);
+        if (!header)
+        {
+            error = path + ": " + error;
+            return {};
+        }
+
+        const auto vertex = std::find_if(header->elements.begin(), header->elements.end(), [](const PlyElement& e) { return e.name == "vertex"; });
+        if (vertex == header->elements.end() || std::min({ VertexLayout(*vertex).position[0], VertexLayout(*vertex).position[1], VertexLayout(*vertex).position[2] }) < 0)
+        {
+            error = path + ": missing vertex positions";
+            return {};
+        }
+
+        MeshData mesh;
+        const bool parsed = header->binary
+            ? parse_ply_binary(file.data(), file.size(), *header, mesh, error)
+            : parse_ply_ascii(file.data() + header->body, file.data() + file.size(), *header, mesh, error);
+        if (!parsed)
+        {
+            error = path + ": " + error;
+            return {};
+        }
+
+        for (const uint32_t index : mesh.indices)
+        {
+            if (index >= mesh.positions.size())
+            {
+                error = path + ": face references vertex that does not exist";
+                return {};
+            }
+        }
+
+        // normals are stored per vertex, so they share index buffer with positions
+        if (!mesh.normals.empty())
+            mesh.normal_indices = mesh.indices;
+
+        return mesh;
+    }
+}
+
+std::optional<MeshData> Scenes::load_mesh(const std::string& path, std::string& error)
+{
+    Utils::MappedFile file;
+    if (!file.open(path))
+    {
+        error = "cannot open " + path;
+        return {};
+    }
+    if (file.size() == 0)
+    {
+        error = path + " is empty";
+        return {};
+    }
+
+    std::string extension = path.substr(std::min(path.size(), path.find_last_of('.')));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    std::optional<MeshData> mesh;
+    if (extension == ".obj")
+        mesh = load_obj(file, path, error);
+    else if (extension == ".ply")
+        mesh = load_ply(file, path, error);
+    else
+    {
+        error = path + ": unknown mesh format (expected .obj or .ply)";
+        return {};
+    }
+
+    if (mesh && mesh->indices.empty())
+    {
+        error = path + ": mesh has no faces";
+        return {};
+    }
+    return mesh;
+}
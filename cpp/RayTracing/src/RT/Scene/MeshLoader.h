@@ -0,0 +1,15 @@
+#pragma once
+#include <optional>
+#include <string>
+
+#include "../Primitives/TriangleMesh.h"
+
+namespace Scenes
+{
+    /// <summary>
+    /// Loads triangle mesh from Wavefront .obj (v, vn, f) or .ply (ascii or binary little endian) file.
+    /// File is memory mapped and split into chunks parsed by all hardware threads, polygons are fan triangulated.
+    /// Returns nullopt and fills `error` if file cannot be read or is malformed.
+    /// </summary>
+    std::optional<Primitives::MeshData> load_mesh(const std::string& path, std::string& error);
+}
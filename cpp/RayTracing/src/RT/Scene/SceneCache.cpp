@@ -0,0 +1,441 @@
+#include "SceneCache.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "../Primitives/Sphere.h"
+#include "../Primitives/SphereSet.h"
+#include "../Primitives/TriangleMesh.h"
+#include "../../Utils/MappedFile.h"
+
+using namespace Primitives;
+
+namespace
+{
+    constexpr char magic[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0' };
+    // 2 - emissive materials
+    constexpr uint32_t version = 2;
+    constexpr uint32_t endian_mark = 0x01020304u;
+    constexpr uint64_t alignment = 64;
+
+    enum class BlockType : uint32_t
+    {
+        Materials = 1,
+        Sphere = 2,
+        SphereSet = 3,
+        Mesh = 4,
+    };
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t endian;
+        // sizes of structs stored raw, files written by build with other layout are rejected
+        uint32_t material_size;
+        uint32_t node_size;
+        uint32_t block_count;
+        float camera_pos[3];
+        float camera_dir[3];
+        float focal;
+        uint64_t table; // offset of BlockEntry[block_count]
+    };
+
+    // `count` is number of records in block (materials, spheres), 1 for mesh
+    struct BlockEntry
+    {
+        uint32_t type;
+        uint32_t count;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct SphereRecord
+    {
+        float center[3];
+        float radius;
+        uint32_t material;
+    };
+
+    // array offsets are relative to start of block
+    struct MeshHeader
+    {
+        uint64_t vertices;
+        uint64_t normals;
+        uint64_t triangles;
+        uint64_t nodes;
+        uint32_t material;
+        uint32_t has_normal_indices;
+        uint64_t px, py, pz;
+        uint64_t nx, ny, nz;
+        uint64_t indices;
+        uint64_t normal_indices;
+        uint64_t node_array;
+    };
+
+    static_assert(sizeof(FileHeader) == 64 && sizeof(BlockEntry) == 24 && sizeof(SphereRecord) == 20 && sizeof(MeshHeader) == 112,
+        "Scene file structs must not depend on compiler padding.");
+    static_assert(std::is_trivially_copyable_v<Mat::Material> && std::is_trivially_copyable_v<BVH::Node>,
+        "Materials and BVH nodes are stored as raw bytes.");
+
+    uint64_t align_up(uint64_t value)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    class Writer
+    {
+        std::ofstream out;
+        uint64_t pos = 0;
+
+    public:
+        explicit Writer(const std::string& path) : out(path, std::ios::binary | std::ios::trunc) {}
+
+        bool good() const { return static_cast<bool>(out); }
+        uint64_t position() const { return pos; }
+
+        void write(const void* data, size_t bytes)
+        {
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            pos += bytes;
+        }
+
+        template <typename T>
+        void write(const T& value)
+        {
+            write(&value, sizeof(T));
+        }
+
+        uint64_t align()
+        {
+            static const char zeros[alignment] = {};
+            write(zeros, align_up(pos) - pos);
+            return pos;
+        }
+
+        void patch(uint64_t at, const void* data, size_t bytes)
+        {
+            out.seekp(static_cast<std::streamoff>(at));
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            out.seekp(static_cast<std::streamoff>(pos));
+        }
+    };
+
+    SphereRecord record(const glm::vec3& center, float radius, uint32_t material)
+    {
+        return { { center.x, center.y, center.z }, radius, material };
+    }
+
+    BlockEntry write_mesh(Writer& out, const TriangleMesh& mesh)
+    {
+        const auto& buf = mesh.buffers();
+        const uint64_t start = out.align();
+
+        MeshHeader header{};
+        header.vertices = buf.vertices;
+        header.normals = buf.normals;
+        header.triangles = buf.triangles;
+        header.nodes = buf.node_count;
+        header.material = mesh.material();
+        header.has_normal_indices = buf.normal_indices != nullptr;
+
+        // lay arrays out behind header, every one aligned
+        uint64_t next = align_up(sizeof(MeshHeader));
+        auto place = [&](uint64_t bytes)
+        {
+            const uint64_t at = next;
+            next = align_up(next + bytes);
+            return at;
+        };
+
+        const uint64_t vertex_bytes = buf.vertices * sizeof(float);
+        const uint64_t normal_bytes = buf.normals * sizeof(float);
+        const uint64_t index_bytes = 3 * buf.triangles * sizeof(uint32_t);
+
+        header.px = place(vertex_bytes);
+        header.py = place(vertex_bytes);
+        header.pz = place(vertex_bytes);
+        header.nx = place(normal_bytes);
+        header.ny = place(normal_bytes);
+        header.nz = place(normal_bytes);
+        header.indices = place(index_bytes);
+        header.normal_indices = place(header.has_normal_indices ? index_bytes : 0);
+        header.node_array = place(buf.node_count * sizeof(BVH::Node));
+
+        out.write(header);
+
+        // same order as `place` calls above
+        auto array = [&](const void* data, uint64_t bytes)
+        {
+            out.align();
+            if (bytes != 0)
+                out.write(data, bytes);
+        };
+
+        array(buf.px, vertex_bytes);
+        array(buf.py, vertex_bytes);
+        array(buf.pz, vertex_bytes);
+        array(buf.nx, normal_bytes);
+        array(buf.ny, normal_bytes);
+        array(buf.nz, normal_bytes);
+        array(buf.indices, index_bytes);
+        array(buf.normal_indices, header.has_normal_indices ? index_bytes : 0);
+        array(buf.nodes, buf.node_count * sizeof(BVH::Node));
+
+        return { static_cast<uint32_t>(BlockType::Mesh), 1, start, out.position() - start };
+    }
+
+    // array of `count` T at `offset` inside block, nullptr if it does not fit or is misaligned
+    template <typename T>
+    const T* view(const char* block, uint64_t block_size, uint64_t offset, uint64_t count)
+    {
+        if (offset % alignof(T) != 0 || offset > block_size || count > (block_size - offset) / sizeof(T))
+            return nullptr;
+        return reinterpret_cast<const T*>(block + offset);
+    }
+
+    // BVH traversal follows node links without checks, so a loaded tree must keep the builder's layout:
+    // children after their parent and inside the array, leaves inside the triangles, depth within traversal stack
+    bool valid_nodes(const BVH::Node* nodes, uint64_t count, uint64_t triangles)
+    {
+        std::vector<uint8_t> depth(count, 0);
+        for (uint64_t i = 0; i < count; i++)
+        {
+            const BVH::Node& node = nodes[i];
+            if (node.is_leaf())
+            {
+                if (uint64_t(node.offset) + node.count > triangles)
+                    return false;
+                continue;
+            }
+
+            if (i + 1 >= count || node.offset <= i + 1 || node.offset >= count || depth[i] + 1 >= BVH::max_depth)
+                return false;
+            const uint8_t child = static_cast<uint8_t>(depth[i] + 1);
+            depth[i + 1] = std::max(depth[i + 1], child);
+            depth[node.offset] = std::max(depth[node.offset], child);
+        }
+        return true;
+    }
+}
+
+bool Scenes::is_cache_path(const std::string& path)
+{
+    const std::string extension = cache_extension;
+    if (path.size() < extension.size())
+        return false;
+    return std::equal(extension.begin(), extension.end(), path.end() - extension.size(), [](char a, char b)
+        {
+            return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+        });
+}
+
+bool Scenes::save_cache(const SceneDesc& scene, const std::string& path, std::string& error)
+{
+    Writer out(path);
+    if (!out.good())
+    {
+        error = "cannot create " + path;
+        return false;
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.endian = endian_mark;
+    header.material_size = sizeof(Mat::Material);
+    header.node_size = sizeof(BVH::Node);
+    for (int i = 0; i < 3; i++)
+    {
+        header.camera_pos[i] = scene.camera_pos[i];
+        header.camera_dir[i] = scene.camera_dir[i];
+    }
+    header.focal = scene.focal;
+    out.write(header);
+
+    std::vector<BlockEntry> blocks;
+
+    const uint64_t materials = out.align();
+    for (size_t i = 0; i < scene.materials.size(); i++)
+        out.write(scene.materials[static_cast<Mat::Handle>(i)]);
+    blocks.push_back({ static_cast<uint32_t>(BlockType::Materials), static_cast<uint32_t>(scene.materials.size()), materials, out.position() - materials });
+
+    for (const auto& object : scene.world)
+    {
+        if (const auto* sphere = dynamic_cast<const Sphere*>(object.get()))
+        {
+            const uint64_t start = out.align();
+            out.write(record(sphere->origin, sphere->radius, sphere->mat));
+            blocks.push_back({ static_cast<uint32_t>(BlockType::Sphere), 1, start, out.position() - start });
+        }
+        else if (const auto* set = dynamic_cast<const SphereSet*>(object.get()))
+        {
+            const uint64_t start = out.align();
+            for (size_t i = 0; i < set->size(); i++)
+                out.write(record(set->get_center(i), set->get_radius(i), set->get_material(i)));
+            blocks.push_back({ static_cast<uint32_t>(BlockType::SphereSet), static_cast<uint32_t>(set->size()), start, out.position() - start });
+        }
+        else if (const auto* mesh = dynamic_cast<const TriangleMesh*>(object.get()))
+        {
+            blocks.push_back(write_mesh(out, *mesh));
+        }
+        else
+        {
+            error = "scene contains primitive that cannot be stored in scene file";
+            return false;
+        }
+    }
+
+    header.table = out.align();
+    header.block_count = static_cast<uint32_t>(blocks.size());
+    out.write(blocks.data(), blocks.size() * sizeof(BlockEntry));
+    out.patch(0, &header, sizeof(header));
+
+    if (!out.good())
+    {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+std::optional<Scenes::SceneDesc> Scenes::load_cache(const std::string& path, std::string& error)
+{
+    auto file = std::make_shared<Utils::MappedFile>();
+    if (!file->open(path))
+    {
+        error = "cannot open " + path;
+        return {};
+    }
+
+    const char* data = file->data();
+    const uint64_t size = file->size();
+
+    auto fail = [&](const std::string& reason) -> std::optional<SceneDesc>
+    {
+        error = path + ": " + reason;
+        return {};
+    };
+
+    FileHeader header;
+    if (size < sizeof(FileHeader))
+        return fail("not a scene file");
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+        return fail("not a scene file");
+    if (header.version != version || header.endian != endian_mark || header.material_size != sizeof(Mat::Material) || header.node_size != sizeof(BVH::Node))
+        return fail("scene file was written by incompatible version, write it again");
+
+    const BlockEntry* blocks = view<BlockEntry>(data, size, header.table, header.block_count);
+    if (blocks == nullptr)
+        return fail("corrupted block table");
+
+    SceneDesc scene{ {}, {},
+        { header.camera_pos[0], header.camera_pos[1], header.camera_pos[2] },
+        { header.camera_dir[0], header.camera_dir[1], header.camera_dir[2] },
+        header.focal };
+
+    // materials are referenced by primitives, so they are checked after all blocks were read
+    uint32_t max_material = 0;
+    bool any_material = false;
+    auto use_material = [&](uint32_t material)
+    {
+        max_material = std::max(max_material, material);
+        any_material = true;
+    };
+
+    for (uint32_t b = 0; b < header.block_count; b++)
+    {
+        const BlockEntry& entry = blocks[b];
+        if (entry.offset % alignment != 0 || entry.offset > size || entry.size > size - entry.offset)
+            return fail("corrupted block " + std::to_string(b));
+
+        const char* block = data + entry.offset;
+
+        switch (static_cast<BlockType>(entry.type))
+        {
+        case BlockType::Materials:
+        {
+            const auto* materials = view<Mat::Material>(block, entry.size, 0, entry.count);
+            if (materials == nullptr)
+                return fail("corrupted material table");
+            for (uint32_t i = 0; i < entry.count; i++)
+                scene.materials.add(materials[i]);
+            break;
+        }
+        case BlockType::Sphere:
+        case BlockType::SphereSet:
+        {
+            const auto* spheres = view<SphereRecord>(block, entry.size, 0, entry.count);
+            if (spheres == nullptr || entry.count == 0)
+                return fail("corrupted sphere block " + std::to_string(b));
+
+            auto center = [](const SphereRecord& s) { return glm::vec3(s.center[0], s.center[1], s.center[2]); };
+            if (static_cast<BlockType>(entry.type) == BlockType::Sphere)
+            {
+                scene.world.push_back(std::make_unique<Sphere>(center(spheres[0]), spheres[0].radius, spheres[0].material));
+                use_material(spheres[0].material);
+                break;
+            }
+
+            if (entry.count >= SphereSet::max_size)
+                return fail("sphere block " + std::to_string(b) + " has too many spheres");
+
+            auto set = std::make_unique<SphereSet>();
+            for (uint32_t i = 0; i < entry.count; i++)
+            {
+                set->add(center(spheres[i]), spheres[i].radius, spheres[i].material);
+                use_material(spheres[i].material);
+            }
+            scene.world.push_back(std::move(set));
+            break;
+        }
+        case BlockType::Mesh:
+        {
+            const auto* mesh = view<MeshHeader>(block, entry.size, 0, 1);
+            if (mesh == nullptr)
+                return fail("corrupted mesh block " + std::to_string(b));
+
+            TriangleMesh::Buffers buf;
+            buf.vertices = mesh->vertices;
+            buf.normals = mesh->normals;
+            buf.triangles = mesh->triangles;
+            buf.node_count = mesh->nodes;
+            buf.px = view<float>(block, entry.size, mesh->px, mesh->vertices);
+            buf.py = view<float>(block, entry.size, mesh->py, mesh->vertices);
+            buf.pz = view<float>(block, entry.size, mesh->pz, mesh->vertices);
+            buf.nx = view<float>(block, entry.size, mesh->nx, mesh->normals);
+            buf.ny = view<float>(block, entry.size, mesh->ny, mesh->normals);
+            buf.nz = view<float>(block, entry.size, mesh->nz, mesh->normals);
+            buf.indices = view<uint32_t>(block, entry.size, mesh->indices, 3 * mesh->triangles);
+            buf.nodes = view<BVH::Node>(block, entry.size, mesh->node_array, mesh->nodes);
+
+            const uint32_t* normal_indices = view<uint32_t>(block, entry.size, mesh->normal_indices, mesh->has_normal_indices ? 3 * mesh->triangles : 0);
+            if (mesh->has_normal_indices)
+                buf.normal_indices = normal_indices;
+
+            const bool valid = buf.px && buf.py && buf.pz && buf.nx && buf.ny && buf.nz && buf.indices && buf.nodes && normal_indices
+                && mesh->triangles < (uint64_t(1) << 32) && mesh->vertices < MeshData::no_normal;
+            if (!valid || !valid_nodes(buf.nodes, mesh->nodes, mesh->triangles))
+                return fail("corrupted mesh block " + std::to_string(b));
+
+            scene.world.push_back(std::make_unique<TriangleMesh>(buf, file, mesh->material));
+            use_material(mesh->material);
+            break;
+        }
+        default:
+            return fail("unknown block type " + std::to_string(entry.type));
+        }
+    }
+
+    if (any_material && max_material >= scene.materials.size())
+        return fail("primitive references missing material");
+
+    scene.lights = LightList::collect(scene.world, scene.materials);
+    return scene;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <optional>
+#include <string>
+
+#include "Scenes.h"
+
+namespace Scenes
+{
+    /// <summary>
+    /// Extension of binary scene files written by `save_cache`
+    /// </summary>
+    constexpr const char* cache_extension = ".rtscene";
+
+    bool is_cache_path(const std::string& path);
+
+    /// <summary>
+    /// Writes camera, materials and primitives of `scene` into versioned binary file. Every object is stored
+    /// as separate 64 byte aligned block addressed by offset from start of file, meshes together with their built BVH.
+    /// Supports Sphere, SphereSet and TriangleMesh, returns false and fills `error` for anything else.
+    /// </summary>
+    bool save_cache(const SceneDesc& scene, const std::string& path, std::string& error);
+
+    /// <summary>
+    /// Maps file written by `save_cache`. Mesh buffers and BVH nodes are traced directly from mapping
+    /// (file stays mapped while any mesh references it), only small objects are copied.
+    /// File structure is validated, contents of index buffers are trusted.
+    /// </summary>
+    std::optional<SceneDesc> load_cache(const std::string& path, std::string& error);
+}
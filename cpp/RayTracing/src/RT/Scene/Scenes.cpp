@@ -0,0 +1,231 @@
+#include "Scenes.h"
+#include <algorithm>
+#include <cmath>
+#include <gtc/matrix_transform.hpp>
+
+#include "../Primitives/Sphere.h"
+#include "../Primitives/SphereSet.h"
+#include "../Primitives/TriangleMesh.h"
+#include "../Primitives/BVH.h"
+#include "../Primitives/TLAS.h"
+#include "MeshLoader.h"
+#include "../Material/Material.h"
+#include "../../Utils/Random.h"
+
+using namespace Primitives;
+using namespace Mat;
+
+namespace
+{
+    Scenes::SceneDesc demo()
+    {
+        Scenes::SceneDesc scene{ {}, {}, { -2.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, 1.3f };
+        auto& mats = scene.materials;
+
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f,  0.0f, 0.0f),   0.5f,    mats.add(Material::diffuse(glm::vec3(0.7f, 0.3f, 0.3f)))));
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f,  0.0f, 100.5f), 100.0f,  mats.add(Material::diffuse(glm::vec3(0.21, 0.37, 0.69)))));
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f, -1.0f, 0.2f),   0.3f,    mats.add(Material::metalic(glm::vec3(0.8f, 0.8f, 0.8f), 0.0f))));
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f,  1.0f, 0.0f),   0.4f,    mats.add(Material::refract(10.0f))));
+
+        return scene;
+    }
+
+    // Field of small spheres lying on the ground, meant for stressing acceleration structures.
+    Scenes::SceneDesc spheres()
+    {
+        Scenes::SceneDesc scene{ {}, {}, { -2.0f, 0.0f, -0.5f }, { 1.0f, 0.0f, 0.15f }, 1.3f };
+        auto& mats = scene.materials;
+
+        Utils::PCG32 random(1234);
+
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f, 0.0f, 100.5f), 100.0f, mats.add(Material::diffuse(glm::vec3(0.5f, 0.5f, 0.5f)))));
+
+        SphereSet field;
+
+        for (int i = 0; i < 1000; i++)
+        {
+            const float radius = 0.03f + 0.07f * random.uniform();
+            const float x = random.uniform() * 12.0f;
+            const float y = (random.uniform() - 0.5f) * 10.0f;
+            const glm::vec3 pos(x, y, 0.5f - radius);
+            const float kind = random.uniform();
+
+            Mat::Handle mat;
+            if (kind < 0.7f)
+            {
+                const float r = random.uniform();
+                const float g = random.uniform();
+                const float b = random.uniform();
+                mat = mats.add(Material::diffuse(glm::vec3(r, g, b)));
+            }
+            else if (kind < 0.9f)
+            {
+                const float albedo = 0.5f + 0.5f * random.uniform();
+                mat = mats.add(Material::metalic(glm::vec3(albedo), 0.3f * random.uniform()));
+            }
+            else
+                mat = mats.add(Material::refract(1.5f));
+
+            field.add(pos, radius, mat);
+        }
+
+        // SIMD sets of nearby spheres become BVH leaves
+        for (auto& set : field.split(16))
+            scene.world.push_back(std::move(set));
+
+        return scene;
+    }
+
+    // Pile of spheres standing on z = 0 (z points down), shared by all instances of it.
+    std::shared_ptr<const IHittable> sphere_pile(MaterialTable& mats, Utils::PCG32& random)
+    {
+        const Mat::Handle colors[] = {
+            mats.add(Material::diffuse(glm::vec3(0.25f, 0.5f, 0.2f))),
+            mats.add(Material::diffuse(glm::vec3(0.15f, 0.4f, 0.15f))),
+            mats.add(Material::metalic(glm::vec3(0.8f, 0.7f, 0.4f), 0.2f)),
+        };
+
+        SphereSet pile;
+        for (int i = 0; i < 64; i++)
+        {
+            // narrower and smaller towards the top
+            const float height = random.uniform();
+            const float spread = 0.3f * (1.0f - height);
+            const float radius = 0.04f + 0.06f * (1.0f - height);
+            const float angle = 6.2831853f * random.uniform();
+            const glm::vec3 pos(spread * std::cos(angle), spread * std::sin(angle), -radius - 0.8f * height);
+            pile.add(pos, radius, colors[i % 3]);
+        }
+
+        return std::make_shared<BVH>(pile.split(8));
+    }
+
+    // Forest of 20000 instances of one sphere pile - memory is one pile plus one transform per placement.
+    Scenes::SceneDesc instances()
+    {
+        Scenes::SceneDesc scene{ {}, {}, { -2.0f, 0.0f, -0.5f }, { 1.0f, 0.0f, 0.15f }, 1.3f };
+        auto& mats = scene.materials;
+
+        Utils::PCG32 random(4321);
+
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f, 0.0f, 100.5f), 100.0f, mats.add(Material::diffuse(glm::vec3(0.5f, 0.45f, 0.4f)))));
+
+        const auto pile = sphere_pile(mats, random);
+
+        auto forest = std::make_unique<TLAS>();
+        for (int i = 0; i < 20000; i++)
+        {
+            const glm::vec3 pos(random.uniform() * 60.0f, (random.uniform() - 0.5f) * 60.0f, 0.5f);
+            const float scale = 0.5f + random.uniform();
+
+            glm::mat4 transform = glm::translate(glm::mat4(1.0f), pos);
+            transform = glm::rotate(transform, 6.2831853f * random.uniform(), glm::vec3(0.0f, 0.0f, 1.0f));
+            transform = glm::scale(transform, glm::vec3(scale));
+            forest->add(Instance(pile, transform));
+        }
+        forest->build();
+
+        scene.world.push_back(std::move(forest));
+        return scene;
+    }
+
+    // Adds rectangle a, b, c, d (in order around it) as two triangles
+    void add_quad(MeshData& mesh, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d)
+    {
+        const uint32_t first = static_cast<uint32_t>(mesh.positions.size());
+        mesh.positions.insert(mesh.positions.end(), { a, b, c, d });
+        mesh.indices.insert(mesh.indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+    }
+
+    // Closed room lit only by small sphere lamp under the ceiling - sky is never seen, every path has to find the lamp.
+    Scenes::SceneDesc room()
+    {
+        Scenes::SceneDesc scene{ {}, {}, { -2.0f, 0.0f, -0.5f }, { 1.0f, 0.0f, 0.0f }, 1.3f };
+        auto& mats = scene.materials;
+
+        // x from front wall (behind camera) to back wall, z from ceiling down to floor
+        const float x0 = -2.5f, x1 = 1.5f, y0 = -1.2f, y1 = 1.2f, z0 = -1.5f, z1 = 0.5f;
+        const auto corner = [&](int x, int y, int z) { return glm::vec3(x ? x1 : x0, y ? y1 : y0, z ? z1 : z0); };
+
+        MeshData white, red, green;
+        add_quad(white, corner(0, 0, 1), corner(1, 0, 1), corner(1, 1, 1), corner(0, 1, 1)); // floor
+        add_quad(white, corner(0, 0, 0), corner(0, 1, 0), corner(1, 1, 0), corner(1, 0, 0)); // ceiling
+        add_quad(white, corner(1, 0, 0), corner(1, 1, 0), corner(1, 1, 1), corner(1, 0, 1)); // back
+        add_quad(white, corner(0, 0, 0), corner(0, 0, 1), corner(0, 1, 1), corner(0, 1, 0)); // front
+        add_quad(red, corner(0, 0, 0), corner(1, 0, 0), corner(1, 0, 1), corner(0, 0, 1));
+        add_quad(green, corner(0, 1, 0), corner(0, 1, 1), corner(1, 1, 1), corner(1, 1, 0));
+
+        scene.world.push_back(std::make_unique<TriangleMesh>(white, mats.add(Material::diffuse(glm::vec3(0.73f, 0.73f, 0.73f)))));
+        scene.world.push_back(std::make_unique<TriangleMesh>(red, mats.add(Material::diffuse(glm::vec3(0.65f, 0.05f, 0.05f)))));
+        scene.world.push_back(std::make_unique<TriangleMesh>(green, mats.add(Material::diffuse(glm::vec3(0.12f, 0.45f, 0.15f)))));
+
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.5f, -0.5f, 0.1f), 0.4f, mats.add(Material::diffuse(glm::vec3(0.7f, 0.7f, 0.7f)))));
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f, 0.55f, 0.15f), 0.35f, mats.add(Material::refract(1.5f))));
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.9f, 0.4f, 0.2f), 0.3f, mats.add(Material::metalic(glm::vec3(0.8f, 0.8f, 0.8f), 0.1f))));
+
+        // lamp
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f, 0.0f, -1.3f), 0.08f, mats.add(Material::emissive(glm::vec3(150.0f, 130.0f, 100.0f)))));
+
+        return scene;
+    }
+
+    // Only ground, camera as in demo - meant as stage for loaded meshes.
+    Scenes::SceneDesc empty()
+    {
+        Scenes::SceneDesc scene{ {}, {}, { -2.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, 1.3f };
+        scene.world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f, 0.0f, 100.5f), 100.0f, scene.materials.add(Material::diffuse(glm::vec3(0.5f, 0.5f, 0.5f)))));
+        return scene;
+    }
+}
+
+std::optional<Scenes::SceneDesc> Scenes::make(const std::string& name)
+{
+    std::optional<SceneDesc> scene;
+    if (name == "demo")
+        scene = demo();
+    else if (name == "spheres")
+        scene = spheres();
+    else if (name == "empty")
+        scene = empty();
+    else if (name == "instances")
+        scene = instances();
+    else if (name == "room")
+        scene = room();
+
+    if (scene.has_value())
+        scene->lights = LightList::collect(scene->world, scene->materials);
+    return scene;
+}
+
+std::vector<std::string> Scenes::names()
+{
+    return { "demo", "spheres", "empty", "instances", "room" };
+}
+
+bool Scenes::add_mesh(SceneDesc& scene, const std::string& path, std::string& error)
+{
+    auto mesh = load_mesh(path, error);
+    if (!mesh.has_value())
+        return false;
+
+    // Y-up file coordinates into world where z points down and camera looks along +x (rotation, keeps winding)
+    const auto to_world = [](const glm::vec3& v) { return glm::vec3(-v.z, v.x, -v.y); };
+    for (auto& p : mesh->positions)
+        p = to_world(p);
+    for (auto& n : mesh->normals)
+        n = to_world(n);
+
+    // largest extent becomes 1, bottom touches ground at z = 0.5 under origin
+    const AABB box = mesh->bounds();
+    const glm::vec3 extent = box.max - box.min;
+    const float size = std::max(extent.x, std::max(extent.y, extent.z));
+    const float scale = size > 0.0f ? 1.0f / size : 1.0f;
+    const glm::vec3 anchor(0.5f * (box.min.x + box.max.x), 0.5f * (box.min.y + box.max.y), box.max.z);
+
+    for (auto& p : mesh->positions)
+        p = (p - anchor) * scale + glm::vec3(0.0f, 0.0f, 0.5f);
+
+    const auto mat = scene.materials.add(Material::diffuse(glm::vec3(0.7f, 0.7f, 0.7f)));
+    scene.world.push_back(std::make_unique<TriangleMesh>(*mesh, mat));
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <glm.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../Camera/Camera.h"
+#include "../Primitives/HitVector.h"
+#include "../Primitives/Lights.h"
+#include "../Material/Material.h"
+
+namespace Scenes
+{
+    struct SceneDesc
+    {
+        Primitives::HitVector world;
+        Mat::MaterialTable materials;
+
+        glm::vec3 camera_pos;
+        glm::vec3 camera_dir;
+        float focal;
+
+        // emitters of `world` sampled directly, filled by `make` and `load_cache` after the rest is built
+        Primitives::LightList lights = {};
+
+        Cam::Camera camera(float aspectratio) const
+        {
+            return Cam::Camera(camera_pos, camera_dir, aspectratio, focal);
+        }
+    };
+
+    /// <summary>
+    /// Builds one of predefined scenes by name, returns nullopt if name is unknown.
+    /// </summary>
+    std::optional<SceneDesc> make(const std::string& name);
+
+    std::vector<std::string> names();
+
+    /// <summary>
+    /// Loads mesh from `path` (see `load_mesh`) and places it standing on the ground in front of the camera,
+    /// scaled to unit size. Mesh is expected to be Y-up as usual for .obj / .ply files.
+    /// Returns false and fills `error` if mesh cannot be loaded.
+    /// </summary>
+    bool add_mesh(SceneDesc& scene, const std::string& path, std::string& error);
+}
@@ -7,14 +7,13 @@
 #include "RT/Camera/Camera.h"
 #include "RT/Camera/Ray.h"
 
-#include "RT/Primitives/Sphere.h"
-#include "RT/Primitives/HitVector.h"
+#include "RT/Primitives/BVH.h"
+#include "RT/Scene/Scenes.h"
+#include "RT/Scene/SceneCache.h"
 
-#include "RT/Engine/GuardedRenderTarget.h"
+#include "RT/Engine/RenderTarget.h"
 #include "RT/Engine/RayTracer.h"
 
-#include "RT/Material/Material.h"
-
 #include <random>
 
 int SDL_Error_Handle(std::string message = "[ERROR]:")
@@ -56,26 +55,44 @@ int main(int argc, char* argv[])
     SDL_CaptureMouse(SDL_bool(true));
 
     const float aspectratio = ((float)pixels.h()) / pixels.w();
-    const float fl = 1.3f;
+    // first argument is name of predefined scene or scene file
+    const std::string scene_name = argc > 1 ? argv[1] : "demo";
+    std::string scene_error = "Unknown scene";
+    auto desc = Scenes::is_cache_path(scene_name) ? Scenes::load_cache(scene_name, scene_error) : Scenes::make(scene_name);
+    if (!desc.has_value())
+    {
+        std::cerr << "[ERROR]: " << scene_error << std::endl;
+        return -1;
+    }
+
+    // optional second argument: .obj / .ply mesh placed into the scene
+    if (argc > 2)
+    {
+        std::string error;
+        if (!Scenes::add_mesh(*desc, argv[2], error))
+        {
+            std::cerr << "[ERROR]: " << error << std::endl;
+            return -1;
+        }
+    }
 
-    glm::vec3 camerapos = { -2.0f, 0.0f, 0.0f };
+    const float fl = desc->focal;
+
+    glm::vec3 camerapos = desc->camera_pos;
     glm::vec2 yawpich = { 0.0f, 0.0f };
     glm::vec3 dir_front, dir_right, dir_up;
 
-    Cam::Camera camera(camerapos, { 1.0f, 0.0f, 0.0f }, aspectratio, fl);
-
-    using namespace Primitives;
-    using namespace Mat;
-    HitVector world;
+    Cam::Camera camera = desc->camera(aspectratio);
 
-    world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f,  0.0f, 0.0f),   0.5f,    std::make_shared<Diffuse>(glm::vec3(0.7f, 0.3f, 0.3f))));
-    world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f,  0.0f, 100.5f), 100.0f,  std::make_shared<Diffuse>(glm::vec3(0.21, 0.37, 0.69))));
-    world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f, -1.0f, 0.2f),   0.3f,    std::make_shared<Metalic>(glm::vec3(0.8f, 0.8f, 0.8f), 0.0f)));
-    world.push_back(std::make_unique<Sphere>(glm::vec3(0.0f,  1.0f, 0.0f),   0.4f,    std::make_shared<Refract>(10.0f)));
+    Primitives::BVH scene(std::move(desc->world));
 
-    RT::GuardedRenderTarget target(std::vector<glm::vec3>(pixels.w()*pixels.h()), pixels.w());
+    RT::RenderTarget target(pixels.w(), pixels.h());
 
-    RayTracer engine(pixels, target, world, camera, 32, 5, 32);
+    RayTracer engine(pixels, target, scene, desc->materials, desc->lights, camera, 32, 5, 32);
+    // keep samples of surfaces still visible while navigating
+    engine.renderer.request_reprojection(true);
+    // while moving show low resolution preview if full iteration does not fit into ~30 fps
+    engine.renderer.request_preview(33.0f);
     engine.request_camera_update(camera);
 
     using namespace std::chrono;
@@ -109,6 +126,22 @@ int main(int argc, char* argv[])
             case SDL_KEYDOWN:
                 if(ev.key.keysym.sym < 322)
                     key_pressed[ev.key.keysym.sym] = true;
+                if (ev.key.keysym.sym == SDLK_n && ev.key.repeat == 0)
+                    engine.request_denoise(!engine.is_denoising());
+                if (ev.key.keysym.sym == SDLK_m && ev.key.repeat == 0)
+                {
+                    // cycle samplers, accumulation restarts so the difference is visible
+                    const auto next = static_cast<Utils::SamplerType>((static_cast<int>(engine.renderer.get_sampler()) + 1) % 3);
+                    engine.renderer.request_sampler(next);
+                    engine.request_camera_update(camera);
+                    std::cout << "Sampler: " << Utils::sampler_name(next) << "\n";
+                }
+                if (ev.key.keysym.sym == SDLK_p && ev.key.repeat == 0)
+                {
+                    const std::string path = "snapshot_" + std::to_string(frame_counter) + ".exr";
+                    if (engine.request_snapshot(path))
+                        std::cout << "Saving " << path << "\n";
+                }
                 break;
             case SDL_KEYUP:
                 if (ev.key.keysym.sym < 322)
@@ -206,6 +239,8 @@ int main(int argc, char* argv[])
         SDL_UpdateWindowSurface(window);
     }
     engine.kill_render_thread();
+    if (Utils::Trace::enabled && Utils::Trace::write_json("trace.json"))
+        std::cout << "Trace written to trace.json\n";
 
     SDL_DestroyWindow(window);
     SDL_Quit();
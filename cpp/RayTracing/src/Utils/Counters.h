@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+
+namespace Utils
+{
+	/// <summary>
+	/// Hot path event counters of one thread. Incremented through `thread_counters` without any synchronization,
+	/// whoever runs work on the thread reads them before and after and adds the difference to shared totals.
+	/// </summary>
+	struct Counters
+	{
+		static constexpr int depth_bins = 16;
+
+		uint64_t primary_rays = 0;
+		uint64_t secondary_rays = 0;
+		// visibility tests of light samples (next event estimation)
+		uint64_t shadow_rays = 0;
+		// bounding box tests of BVH traversals (packet test counts once)
+		uint64_t box_tests = 0;
+		// objects / triangles in leaves reached by BVH traversals
+		uint64_t primitive_tests = 0;
+		// finished paths and these of them that left the scene to sky
+		uint64_t paths = 0;
+		uint64_t escaped = 0;
+		// paths by index of their last segment (0 = ended after camera ray), last bin collects deeper ones
+		uint64_t depth[depth_bins] = {};
+
+		void end_path(int bounce, bool to_sky)
+		{
+			paths += 1;
+			escaped += to_sky ? 1 : 0;
+			depth[bounce < depth_bins ? bounce : depth_bins - 1] += 1;
+		}
+
+		Counters& operator+=(const Counters& other)
+		{
+			primary_rays += other.primary_rays;
+			secondary_rays += other.secondary_rays;
+			shadow_rays += other.shadow_rays;
+			box_tests += other.box_tests;
+			primitive_tests += other.primitive_tests;
+			paths += other.paths;
+			escaped += other.escaped;
+			for (int i = 0; i < depth_bins; i++)
+				depth[i] += other.depth[i];
+			return *this;
+		}
+
+		Counters operator-(const Counters& other) const
+		{
+			Counters result = *this;
+			result.primary_rays -= other.primary_rays;
+			result.secondary_rays -= other.secondary_rays;
+			result.shadow_rays -= other.shadow_rays;
+			result.box_tests -= other.box_tests;
+			result.primitive_tests -= other.primitive_tests;
+			result.paths -= other.paths;
+			result.escaped -= other.escaped;
+			for (int i = 0; i < depth_bins; i++)
+				result.depth[i] -= other.depth[i];
+			return result;
+		}
+	};
+
+	inline thread_local Counters thread_counters;
+}
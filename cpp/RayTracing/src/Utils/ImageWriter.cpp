@@ -0,0 +1,144 @@
+#include "ImageWriter.h"
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+
+bool Utils::Image::write_ppm(const std::string& path, const std::vector<glm::vec3>& pixels, size_t w, size_t h, float scale)
+{
+	if (pixels.size() < w * h)
+		return false;
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	file << "P6\n" << w << " " << h << "\n255\n";
+
+	std::vector<uint8_t> row(w * 3);
+	for (size_t y = 0; y < h; y++)
+	{
+		for (size_t x = 0; x < w; x++)
+		{
+			const glm::vec3 color = pixels[x + y * w] * scale;
+			for (int c = 0; c < 3; c++)
+				row[x * 3 + c] = static_cast<uint8_t>(255.999f * std::clamp(color[c], 0.0f, 1.0f));
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), row.size());
+	}
+
+	return static_cast<bool>(file);
+}
+
+namespace
+{
+	// both formats are little endian, like every platform this builds for
+	template<typename T>
+	void put(std::string& out, const T& value)
+	{
+		out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	void put_attribute(std::string& out, const char* name, const char* type, const std::string& value)
+	{
+		out.append(name).push_back('\0');
+		out.append(type).push_back('\0');
+		put(out, static_cast<int32_t>(value.size()));
+		out.append(value);
+	}
+
+	std::string box(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+	{
+		std::string value;
+		for (int32_t v : { x0, y0, x1, y1 })
+			put(value, v);
+		return value;
+	}
+}
+
+bool Utils::Image::write_pfm(const std::string& path, const Plane* planes, size_t count, size_t w, size_t h)
+{
+	if (count != 1 && count != 3)
+		return false;
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	// negative scale marks little endian data
+	file << (count == 3 ? "PF\n" : "Pf\n") << w << " " << h << "\n-1.0\n";
+
+	// rows are stored bottom to top
+	std::vector<float> row(w * count);
+	for (size_t y = h; y-- > 0;)
+	{
+		for (size_t x = 0; x < w; x++)
+			for (size_t c = 0; c < count; c++)
+				row[x * count + c] = planes[c].data[x + y * planes[c].stride];
+		file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+	}
+
+	return static_cast<bool>(file);
+}
+
+bool Utils::Image::write_exr(const std::string& path, std::vector<Plane> planes, size_t w, size_t h)
+{
+	if (planes.empty() || w == 0 || h == 0)
+		return false;
+
+	std::stable_sort(planes.begin(), planes.end(), [](const Plane& a, const Plane& b) { return a.name < b.name; });
+
+	std::string channels;
+	for (const Plane& plane : planes)
+	{
+		channels.append(plane.name).push_back('\0');
+		// FLOAT pixel type, pLinear + 3 reserved bytes, x and y sampling
+		put(channels, int32_t(2));
+		put(channels, uint32_t(0));
+		put(channels, int32_t(1));
+		put(channels, int32_t(1));
+	}
+	channels.push_back('\0');
+
+	std::string header;
+	put(header, uint32_t(20000630));
+	// version 2, single part scanline image
+	put(header, uint32_t(2));
+	put_attribute(header, "channels", "chlist", channels);
+	put_attribute(header, "compression", "compression", std::string(1, '\0'));
+	put_attribute(header, "dataWindow", "box2i", box(0, 0, int32_t(w - 1), int32_t(h - 1)));
+	put_attribute(header, "displayWindow", "box2i", box(0, 0, int32_t(w - 1), int32_t(h - 1)));
+	put_attribute(header, "lineOrder", "lineOrder", std::string(1, '\0'));
+	std::string value;
+	put(value, 1.0f);
+	put_attribute(header, "pixelAspectRatio", "float", value);
+	put_attribute(header, "screenWindowWidth", "float", value);
+	value.clear();
+	put(value, 0.0f);
+	put(value, 0.0f);
+	put_attribute(header, "screenWindowCenter", "v2f", value);
+	header.push_back('\0');
+
+	// one chunk per scanline: y, byte count, then every channel of the line one after another
+	const size_t line_bytes = w * planes.size() * sizeof(float);
+	const uint64_t first = header.size() + h * sizeof(uint64_t);
+	for (size_t y = 0; y < h; y++)
+		put(header, uint64_t(first + y * (2 * sizeof(int32_t) + line_bytes)));
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	file.write(header.data(), header.size());
+
+	std::vector<float> line(w * planes.size());
+	for (size_t y = 0; y < h; y++)
+	{
+		for (size_t c = 0; c < planes.size(); c++)
+			std::copy_n(planes[c].data + y * planes[c].stride, w, line.begin() + c * w);
+
+		const int32_t chunk[2] = { int32_t(y), int32_t(line_bytes) };
+		file.write(reinterpret_cast<const char*>(chunk), sizeof(chunk));
+		file.write(reinterpret_cast<const char*>(line.data()), line_bytes);
+	}
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <glm.hpp>
+#include <string>
+#include <vector>
+
+namespace Utils
+{
+	namespace Image
+	{
+		/// <summary>
+		/// Writes binary PPM (P6), every pixel is multiplied by `scale` and clamped to [0, 1]
+		/// </summary>
+		bool write_ppm(const std::string& path, const std::vector<glm::vec3>& pixels, size_t w, size_t h, float scale = 1.0f);
+
+		/// <summary>
+		/// One float channel of planar image
+		/// </summary>
+		struct Plane
+		{
+			std::string name;
+			// first pixel of top row, rows are `stride` floats apart
+			const float* data = nullptr;
+			size_t stride = 0;
+		};
+
+		/// <summary>
+		/// Writes little endian PFM, 1 plane gives grayscale (Pf), 3 planes give color (PF) image.
+		/// Names of planes are not stored.
+		/// </summary>
+		bool write_pfm(const std::string& path, const Plane* planes, size_t count, size_t w, size_t h);
+
+		/// <summary>
+		/// Writes uncompressed scanline OpenEXR with 32 bit float channels named after planes
+		/// ("layer.R" style names group channels into layers). Channels are stored sorted by name as the format requires.
+		/// </summary>
+		bool write_exr(const std::string& path, std::vector<Plane> planes, size_t w, size_t h);
+	}
+}
@@ -0,0 +1,112 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+
+bool Utils::MappedFile::open(const std::string& path)
+{
+	close();
+
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		close();
+		return false;
+	}
+	length = static_cast<size_t>(size.QuadPart);
+	if (length == 0)
+		return true;
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	ptr = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (ptr == nullptr)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void Utils::MappedFile::close()
+{
+	if (ptr != nullptr)
+		UnmapViewOfFile(ptr);
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	if (file != nullptr)
+		CloseHandle(file);
+
+	ptr = nullptr;
+	mapping = nullptr;
+	file = nullptr;
+	length = 0;
+}
+
+#else
+
+bool Utils::MappedFile::open(const std::string& path)
+{
+	close();
+
+	fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		close();
+		return false;
+	}
+	length = static_cast<size_t>(info.st_size);
+	if (length == 0)
+		return true;
+
+	void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	// whole file is going to be parsed, start read-ahead right away
+	madvise(mapped, length, MADV_WILLNEED);
+	ptr = static_cast<const char*>(mapped);
+	return true;
+}
+
+void Utils::MappedFile::close()
+{
+	if (ptr != nullptr)
+		munmap(const_cast<char*>(ptr), length);
+	if (fd >= 0)
+		::close(fd);
+
+	ptr = nullptr;
+	fd = -1;
+	length = 0;
+}
+
+#endif
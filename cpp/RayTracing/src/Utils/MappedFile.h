@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+namespace Utils
+{
+	/// <summary>
+	/// Read-only memory mapping of whole file. Pages are loaded by OS on first touch,
+	/// so file can be parsed by many threads without copying it into memory first.
+	/// </summary>
+	class MappedFile
+	{
+		const char* ptr = nullptr;
+		size_t length = 0;
+#ifdef _WIN32
+		void* file = nullptr;
+		void* mapping = nullptr;
+#else
+		int fd = -1;
+#endif
+
+		void close();
+
+	public:
+		MappedFile() = default;
+		~MappedFile() { close(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/// <summary>
+		/// Maps file at `path`, previous mapping is released. Returns false if file cannot be opened.
+		/// </summary>
+		bool open(const std::string& path);
+
+		/// <summary>
+		/// Contents of file, nullptr for empty file
+		/// </summary>
+		const char* data() const { return ptr; }
+		size_t size() const { return length; }
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+
+namespace Utils
+{
+	/// <summary>
+	/// splitmix64 finalizer, used to derive independent seeds from (seed, counter) pairs
+	/// </summary>
+	inline uint64_t mix_seed(uint64_t seed, uint64_t counter)
+	{
+		uint64_t z = seed + 0x9E3779B97F4A7C15ull * (counter + 1);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	/// <summary>
+	/// PCG-XSH-RR generator (16 bytes of state). Cheap to construct,
+	/// so every pixel sample can get its own stream and results do not depend on thread scheduling.
+	/// Satisfies UniformRandomBitGenerator, so it works with <random> distributions too.
+	/// </summary>
+	class PCG32
+	{
+		uint64_t state;
+		uint64_t inc;
+	public:
+		using result_type = uint32_t;
+
+		PCG32(uint64_t seed, uint64_t stream = 0) : state(0), inc((stream << 1u) | 1u)
+		{
+			(*this)();
+			state += seed;
+			(*this)();
+		}
+
+		result_type operator()()
+		{
+			const uint64_t old = state;
+			state = old * 6364136223846793005ull + inc;
+			const uint32_t xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+			const uint32_t rot = static_cast<uint32_t>(old >> 59u);
+			return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31u));
+		}
+
+		/// <summary>
+		/// Uniform float in [0, 1)
+		/// </summary>
+		float uniform()
+		{
+			return ((*this)() >> 8) * (1.0f / 16777216.0f);
+		}
+
+		/// <summary>
+		/// Uniform float in [a, b)
+		/// </summary>
+		float uniform(float a, float b)
+		{
+			return a + (b - a) * uniform();
+		}
+
+		static constexpr result_type min() { return 0; }
+		static constexpr result_type max() { return UINT32_MAX; }
+	};
+}
@@ -0,0 +1,155 @@
+#include "Sampler.h"
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t size = Utils::blue_noise_size;
+	constexpr uint32_t count = size * size;
+	// void and cluster filter width, 1.5 is the usual choice (Ulichney 1993)
+	constexpr float sigma = 1.5f;
+
+	/// <summary>
+	/// Gaussian energy of binary pattern on torus. Void is the empty pixel of lowest energy,
+	/// cluster the filled pixel of highest one.
+	/// </summary>
+	class Energy
+	{
+		std::vector<float> kernel;
+		std::vector<float> energy;
+
+	public:
+		std::vector<uint8_t> filled;
+
+		Energy() : kernel(count), energy(count, 0.0f), filled(count, 0)
+		{
+			for (uint32_t y = 0; y < size; y++)
+			{
+				for (uint32_t x = 0; x < size; x++)
+				{
+					const float dx = static_cast<float>(std::min(x, size - x));
+					const float dy = static_cast<float>(std::min(y, size - y));
+					kernel[x + y * size] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+				}
+			}
+		}
+
+		void set(uint32_t pixel, bool value)
+		{
+			filled[pixel] = value;
+			const float sign = value ? 1.0f : -1.0f;
+			const uint32_t px = pixel % size, py = pixel / size;
+			for (uint32_t y = 0; y < size; y++)
+				for (uint32_t x = 0; x < size; x++)
+					energy[x + y * size] += sign * kernel[((x - px) & (size - 1)) + ((y - py) & (size - 1)) * size];
+		}
+
+		uint32_t tightest_cluster() const
+		{
+			uint32_t best = 0;
+			float best_energy = -INFINITY;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (filled[i] && energy[i] > best_energy)
+				{
+					best_energy = energy[i];
+					best = i;
+				}
+			}
+			return best;
+		}
+
+		uint32_t largest_void() const
+		{
+			uint32_t best = 0;
+			float best_energy = INFINITY;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!filled[i] && energy[i] < best_energy)
+				{
+					best_energy = energy[i];
+					best = i;
+				}
+			}
+			return best;
+		}
+	};
+
+	std::vector<float> void_and_cluster()
+	{
+		// initial pattern - random tenth of pixels, then moves from tightest cluster to largest void until stable
+		Energy pattern;
+		Utils::PCG32 random(0x5eed);
+		uint32_t ones = 0;
+		while (ones < count / 10)
+		{
+			const uint32_t pixel = random() % count;
+			if (!pattern.filled[pixel])
+			{
+				pattern.set(pixel, true);
+				ones += 1;
+			}
+		}
+		for (;;)
+		{
+			const uint32_t cluster = pattern.tightest_cluster();
+			pattern.set(cluster, false);
+			const uint32_t hole = pattern.largest_void();
+			pattern.set(hole, true);
+			if (hole == cluster)
+				break;
+		}
+
+		std::vector<uint32_t> rank(count);
+
+		// lower ranks - remove clusters of initial pattern one by one
+		Energy removal = pattern;
+		for (uint32_t r = ones; r-- > 0;)
+		{
+			const uint32_t cluster = removal.tightest_cluster();
+			removal.set(cluster, false);
+			rank[cluster] = r;
+		}
+
+		// higher ranks - fill voids until full. Void and cluster switches to clusters of the inverted pattern
+		// past half, filling voids is simpler and differs only in the last ranks.
+		for (uint32_t r = ones; r < count; r++)
+		{
+			const uint32_t hole = pattern.largest_void();
+			pattern.set(hole, true);
+			rank[hole] = r;
+		}
+
+		std::vector<float> mask(count);
+		for (uint32_t i = 0; i < count; i++)
+			mask[i] = (rank[i] + 0.5f) / count;
+		return mask;
+	}
+}
+
+const char* Utils::sampler_name(SamplerType type)
+{
+	switch (type)
+	{
+	case SamplerType::Random:
+		return "random";
+	case SamplerType::Sobol:
+		return "sobol";
+	case SamplerType::BlueNoise:
+		return "bluenoise";
+	}
+	return "unknown";
+}
+
+std::optional<Utils::SamplerType> Utils::parse_sampler(const std::string& name)
+{
+	for (SamplerType type : { SamplerType::Random, SamplerType::Sobol, SamplerType::BlueNoise })
+		if (name == sampler_name(type))
+			return type;
+	return std::nullopt;
+}
+
+const float* Utils::blue_noise_mask()
+{
+	static const std::vector<float> mask = void_and_cluster();
+	return mask.data();
+}
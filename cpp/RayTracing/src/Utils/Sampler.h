@@ -0,0 +1,178 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+#include <optional>
+#include <glm.hpp>
+#include "Random.h"
+
+namespace Utils
+{
+	enum class SamplerType : uint8_t
+	{
+		// independent uniform numbers, every pixel sample has its own PCG32 stream
+		Random,
+		// Owen scrambled Sobol (0, 2) sequence, index and digits are scrambled per pixel and dimension
+		Sobol,
+		// Sobol sequence shared by all pixels, rotated by blue noise mask - error is distributed as blue noise over the image
+		BlueNoise,
+	};
+
+	const char* sampler_name(SamplerType type);
+	std::optional<SamplerType> parse_sampler(const std::string& name);
+
+	/// <summary>
+	/// Blue noise threshold mask of `blue_noise_size` x `blue_noise_size` pixels (tileable) with values (rank + 0.5) / count,
+	/// generated by void and cluster on first use.
+	/// </summary>
+	const float* blue_noise_mask();
+	constexpr uint32_t blue_noise_size = 64;
+
+	namespace Sobol
+	{
+		inline uint32_t reverse_bits(uint32_t v)
+		{
+			v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+			v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+			v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+			v = ((v >> 8) & 0x00FF00FFu) | ((v & 0x00FF00FFu) << 8);
+			return (v >> 16) | (v << 16);
+		}
+
+		/// <summary>
+		/// Hash based nested uniform (Owen) scramble (Burley 2020) of bit reversed value - every bit is flipped depending
+		/// only on bits below it, which are the higher digits of the value. So elementary intervals, and stratification
+		/// of the sequence, are kept.
+		/// </summary>
+		inline uint32_t laine_karras(uint32_t v, uint32_t seed)
+		{
+			v ^= v * 0x3d20adeau;
+			v += seed;
+			v *= (seed >> 16) | 1u;
+			v ^= v * 0x05526c56u;
+			v ^= v * 0x53a22864u;
+			return v;
+		}
+
+		/// <summary>
+		/// Second Sobol dimension is XOR of direction numbers of set index bits, all of them m = 1,
+		/// so v(i) = v(i - 1) ^ (v(i - 1) >> 1). Tabulated per index byte (scrambled indices use all 32 bits)
+		/// and bit reversed, which is what scrambling takes.
+		/// </summary>
+		struct Dim1Table
+		{
+			uint32_t bytes[4][256] = {};
+
+			constexpr Dim1Table()
+			{
+				uint32_t directions[32] = {};
+				directions[0] = 1u;
+				for (int i = 1; i < 32; i++)
+					directions[i] = directions[i - 1] ^ (directions[i - 1] << 1);
+
+				for (int byte = 0; byte < 4; byte++)
+					for (uint32_t value = 0; value < 256; value++)
+						for (int bit = 0; bit < 8; bit++)
+							bytes[byte][value] ^= (value >> bit & 1) ? directions[byte * 8 + bit] : 0;
+			}
+		};
+		inline constexpr Dim1Table dim1_table{};
+
+		/// <summary>
+		/// Owen scrambled point of first two Sobol dimensions as 0.32 fixed point. Index is scrambled too, which
+		/// shuffles order of points - different `seed`s give decorrelated sequences (padding of higher dimensions).
+		/// </summary>
+		inline void scrambled2d(uint32_t index, uint32_t seed, uint32_t& x, uint32_t& y)
+		{
+			// first dimension is van der Corput, bit reversed index
+			const uint32_t shuffled = reverse_bits(laine_karras(reverse_bits(index), seed));
+			const uint32_t y_reversed = dim1_table.bytes[0][shuffled & 0xFF] ^ dim1_table.bytes[1][shuffled >> 8 & 0xFF]
+				^ dim1_table.bytes[2][shuffled >> 16 & 0xFF] ^ dim1_table.bytes[3][shuffled >> 24];
+			x = reverse_bits(laine_karras(shuffled, seed * 0x9E3779B9u + 1));
+			y = reverse_bits(laine_karras(y_reversed, seed * 0x85EBCA6Bu + 2));
+		}
+
+		// 0.32 fixed point to float in [0, 1), 24 bits so it never rounds up to 1
+		inline float to_float(uint32_t v)
+		{
+			return (v >> 8) * (1.0f / 16777216.0f);
+		}
+	}
+
+	/// <summary>
+	/// Sample generator of one pixel sample. Numbers are drawn by dimensions - every `get1d` or `get2d` takes next one.
+	/// Path tracer calls `start_bounce` before every bounce, so the same dimension always feeds the same decision
+	/// (dimension 0 is position in pixel) and low discrepancy samplers stratify every decision across samples of a pixel.
+	/// `index` is number of the sample within its pixel, consecutive indices of one pixel form the sequence.
+	/// Cheap to construct, so results do not depend on thread scheduling.
+	/// </summary>
+	class Sampler
+	{
+		PCG32 random;
+		SamplerType type;
+		uint32_t x, y;
+		uint32_t index;
+		uint32_t dimension = 0;
+		// Sobol - per pixel scramble, BlueNoise - scramble shared by all pixels
+		uint64_t scramble;
+
+	public:
+		// dimensions of one bounce: scatter direction (2d), scatter extra (1d), roulette (1d), light direction (2d), light choice (1d)
+		static constexpr uint32_t scatter_dimension = 0;
+		static constexpr uint32_t roulette_dimension = 2;
+		static constexpr uint32_t light_dimension = 3;
+		static constexpr uint32_t bounce_dimensions = 5;
+
+		Sampler(SamplerType type, uint64_t seed, uint32_t x, uint32_t y, uint32_t index) :
+			random(type == SamplerType::Random ? mix_seed(seed, index) : seed, uint64_t(y) << 32 | x),
+			type(type), x(x), y(y), index(index),
+			scramble(type == SamplerType::Sobol ? mix_seed(seed, uint64_t(y) << 32 | x) : mix_seed(seed, ~uint64_t(0)))
+		{
+		}
+
+		SamplerType get_type() const { return type; }
+
+		/// <summary>
+		/// Next draws feed bounce `bounce` (0 scatters at first hit) starting with its dimension `offset`
+		/// </summary>
+		void start_bounce(int bounce, uint32_t offset = scatter_dimension)
+		{
+			dimension = 1 + static_cast<uint32_t>(bounce) * bounce_dimensions + offset;
+		}
+
+		float get1d()
+		{
+			return type == SamplerType::Random ? random.uniform() : get2d().x;
+		}
+
+		glm::vec2 get2d()
+		{
+			if (type == SamplerType::Random)
+			{
+				// separate statements, argument evaluation order would make streams compiler dependent
+				const float u = random.uniform();
+				const float v = random.uniform();
+				return { u, v };
+			}
+
+			const uint64_t hash = mix_seed(scramble, dimension++);
+			const uint32_t seed = static_cast<uint32_t>(hash);
+			uint32_t u, v;
+			Sobol::scrambled2d(index, seed, u, v);
+			if (type == SamplerType::Sobol)
+				return { Sobol::to_float(u), Sobol::to_float(v) };
+
+			// Cranley-Patterson rotation of shared sequence by two mask values far apart, mask is shifted per dimension
+			const uint32_t mask = blue_noise_size - 1;
+			const uint32_t mx = x + static_cast<uint32_t>(hash >> 32), my = y + static_cast<uint32_t>(hash >> 48);
+			const float* noise = blue_noise_mask();
+			const float du = noise[(mx & mask) + (my & mask) * blue_noise_size];
+			const float dv = noise[((mx + blue_noise_size / 2) & mask) + ((my + blue_noise_size / 2) & mask) * blue_noise_size];
+			const float su = Sobol::to_float(u) + du;
+			const float sv = Sobol::to_float(v) + dv;
+			// wrap, then keep below 1 where float addition rounded up
+			return { std::min(su - std::floor(su), 0.99999994f), std::min(sv - std::floor(sv), 0.99999994f) };
+		}
+	};
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// SSE2 is baseline on x64 (and Release|x64 is built with /arch:SSE2), everything else uses plain loops.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RT_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace Utils
+{
+	/// <summary>
+	/// 4-wide float vector. Comparisons return lane masks (all bits set in true lanes),
+	/// `movemask` packs them into lowest 4 bits of an int.
+	/// </summary>
+	struct float4
+	{
+#ifdef RT_SIMD_SSE
+		__m128 v;
+
+		float4() : v(_mm_setzero_ps()) {}
+		float4(__m128 v) : v(v) {}
+		float4(float s) : v(_mm_set1_ps(s)) {}
+		float4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+
+		static float4 load(const float* p) { return _mm_load_ps(p); }
+		static float4 loadu(const float* p) { return _mm_loadu_ps(p); }
+		void store(float* p) const { _mm_store_ps(p, v); }
+#else
+		float v[4];
+
+		float4() : v{ 0.0f, 0.0f, 0.0f, 0.0f } {}
+		float4(float s) : v{ s, s, s, s } {}
+		float4(float a, float b, float c, float d) : v{ a, b, c, d } {}
+
+		static float4 load(const float* p) { float4 r; std::copy(p, p + 4, r.v); return r; }
+		static float4 loadu(const float* p) { return load(p); }
+		void store(float* p) const { std::copy(v, v + 4, p); }
+#endif
+	};
+
+#ifdef RT_SIMD_SSE
+	inline float4 operator+(float4 a, float4 b) { return _mm_add_ps(a.v, b.v); }
+	inline float4 operator-(float4 a, float4 b) { return _mm_sub_ps(a.v, b.v); }
+	inline float4 operator*(float4 a, float4 b) { return _mm_mul_ps(a.v, b.v); }
+	inline float4 operator/(float4 a, float4 b) { return _mm_div_ps(a.v, b.v); }
+
+	inline float4 operator<(float4 a, float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+	inline float4 operator<=(float4 a, float4 b) { return _mm_cmple_ps(a.v, b.v); }
+	inline float4 operator>(float4 a, float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+	inline float4 operator>=(float4 a, float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+	inline float4 operator&(float4 a, float4 b) { return _mm_and_ps(a.v, b.v); }
+	inline float4 operator|(float4 a, float4 b) { return _mm_or_ps(a.v, b.v); }
+
+	inline float4 min(float4 a, float4 b) { return _mm_min_ps(a.v, b.v); }
+	inline float4 max(float4 a, float4 b) { return _mm_max_ps(a.v, b.v); }
+	inline float4 sqrt(float4 a) { return _mm_sqrt_ps(a.v); }
+	// approximate 1 / sqrt(a), ~12 bits of precision
+	inline float4 rsqrt(float4 a) { return _mm_rsqrt_ps(a.v); }
+	// approximate 1 / a, ~12 bits of precision
+	inline float4 rcp(float4 a) { return _mm_rcp_ps(a.v); }
+
+	// mask ? a : b
+	inline float4 select(float4 mask, float4 a, float4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+	inline int movemask(float4 mask) { return _mm_movemask_ps(mask.v); }
+
+	// inverse of movemask, lane `i` is set if bit `i` of `bits` is
+	inline float4 lane_mask(int bits)
+	{
+		const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+		return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lanes), lanes));
+	}
+
+	// truncates lanes to int32 and stores them to (unaligned) `p`
+	inline void store_int(float4 a, int32_t* p) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvttps_epi32(a.v)); }
+#else
+	namespace detail
+	{
+		template <typename F>
+		float4 map(float4 a, float4 b, F f) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = f(a.v[i], b.v[i]); return r; }
+		inline float mask_of(bool b) { uint32_t bits = b ? ~0u : 0u; float f; std::memcpy(&f, &bits, 4); return f; }
+		inline uint32_t bits_of(float f) { uint32_t bits; std::memcpy(&bits, &f, 4); return bits; }
+	}
+
+	inline float4 operator+(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x + y; }); }
+	inline float4 operator-(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x - y; }); }
+	inline float4 operator*(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x * y; }); }
+	inline float4 operator/(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x / y; }); }
+
+	inline float4 operator<(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::mask_of(x < y); }); }
+	inline float4 operator<=(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::mask_of(x <= y); }); }
+	inline float4 operator>(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::mask_of(x > y); }); }
+	inline float4 operator>=(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::mask_of(x >= y); }); }
+	inline float4 operator&(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::mask_of(detail::bits_of(x) && detail::bits_of(y)); }); }
+	inline float4 operator|(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return detail::mask_of(detail::bits_of(x) || detail::bits_of(y)); }); }
+
+	inline float4 min(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x < y ? x : y; }); }
+	inline float4 max(float4 a, float4 b) { return detail::map(a, b, [](float x, float y) { return x > y ? x : y; }); }
+	inline float4 sqrt(float4 a) { return detail::map(a, a, [](float x, float) { return std::sqrt(x); }); }
+	inline float4 rsqrt(float4 a) { return detail::map(a, a, [](float x, float) { return 1.0f / std::sqrt(x); }); }
+	inline float4 rcp(float4 a) { return detail::map(a, a, [](float x, float) { return 1.0f / x; }); }
+
+	// mask ? a : b
+	inline float4 select(float4 mask, float4 a, float4 b) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = detail::bits_of(mask.v[i]) ? a.v[i] : b.v[i]; return r; }
+	inline int movemask(float4 mask) { int r = 0; for (int i = 0; i < 4; i++) r |= (detail::bits_of(mask.v[i]) >> 31) << i; return r; }
+
+	// inverse of movemask, lane `i` is set if bit `i` of `bits` is
+	inline float4 lane_mask(int bits) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = detail::mask_of(bits >> i & 1); return r; }
+
+	// truncates lanes to int32 and stores them to (unaligned) `p`
+	inline void store_int(float4 a, int32_t* p) { for (int i = 0; i < 4; i++) p[i] = static_cast<int32_t>(a.v[i]); }
+#endif
+}
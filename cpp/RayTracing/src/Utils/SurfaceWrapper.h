@@ -51,6 +51,17 @@ namespace Utils
 			pixels[x + y * _w].b = static_cast<int>(255.999 * color.b);
 
 		}
+		/// <summary>
+		/// Raw pixels, rows are `pitch` pixels apart
+		/// </summary>
+		uint32_t* data()
+		{
+			return reinterpret_cast<uint32_t*>(surf->pixels);
+		}
+		size_t pitch()
+		{
+			return surf->pitch / sizeof(Pixel);
+		}
 		int w()
 		{
 			return surf->w;
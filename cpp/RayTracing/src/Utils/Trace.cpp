@@ -0,0 +1,185 @@
+#include "Trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct Event
+	{
+		const char* name;
+		uint64_t ts;
+		// duration of complete event, id of flow event
+		uint64_t value;
+		char phase;
+	};
+
+	constexpr size_t chunk_size = 4096;
+	constexpr size_t max_chunks = 1024;
+
+	/// <summary>
+	/// Events of one thread. Only owner writes, chunks never move, so reader can take everything below `count`
+	/// while owner keeps appending.
+	/// </summary>
+	struct ThreadBuffer
+	{
+		uint32_t tid = 0;
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<size_t> count{ 0 };
+		std::unique_ptr<Event[]> chunks[max_chunks];
+
+		void push(const Event& event)
+		{
+			const size_t n = count.load(std::memory_order_relaxed);
+			// full buffer drops newest events
+			if (n >= chunk_size * max_chunks)
+				return;
+
+			auto& chunk = chunks[n / chunk_size];
+			if (!chunk)
+				chunk.reset(new Event[chunk_size]);
+			chunk[n % chunk_size] = event;
+			count.store(n + 1, std::memory_order_release);
+		}
+	};
+
+	struct Registry
+	{
+		std::mutex lock;
+		std::vector<std::unique_ptr<ThreadBuffer>> threads;
+		const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+	};
+
+	Registry& registry()
+	{
+		static Registry instance;
+		return instance;
+	}
+
+	ThreadBuffer& local()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			Registry& r = registry();
+			std::lock_guard<std::mutex> guard(r.lock);
+			r.threads.push_back(std::make_unique<ThreadBuffer>());
+			buffer = r.threads.back().get();
+			buffer->tid = static_cast<uint32_t>(r.threads.size());
+		}
+		return *buffer;
+	}
+
+	void write_string(std::ostream& out, const char* s)
+	{
+		out << '"';
+		for (; *s; s++)
+		{
+			if (*s == '"' || *s == '\\')
+				out << '\\';
+			out << *s;
+		}
+		out << '"';
+	}
+
+	// trace event timestamps are in microseconds
+	void write_time(std::ostream& out, uint64_t ns)
+	{
+		char text[32];
+		std::snprintf(text, sizeof(text), "%llu.%03llu", static_cast<unsigned long long>(ns / 1000), static_cast<unsigned long long>(ns % 1000));
+		out << text;
+	}
+}
+
+uint64_t Utils::Trace::now()
+{
+	using namespace std::chrono;
+	return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now() - registry().origin).count());
+}
+
+void Utils::Trace::set_thread_name(const char* name)
+{
+	local().name.store(name, std::memory_order_release);
+}
+
+void Utils::Trace::complete(const char* name, uint64_t start)
+{
+	local().push({ name, start, now() - start, 'X' });
+}
+
+void Utils::Trace::instant(const char* name)
+{
+	local().push({ name, now(), 0, 'i' });
+}
+
+void Utils::Trace::flow_begin(const char* name, uint64_t id)
+{
+	local().push({ name, now(), id, 's' });
+}
+
+void Utils::Trace::flow_end(const char* name, uint64_t id)
+{
+	local().push({ name, now(), id, 'f' });
+}
+
+bool Utils::Trace::write_json(const std::string& path)
+{
+	std::ofstream out(path);
+	if (!out)
+		return false;
+
+	Registry& r = registry();
+	std::lock_guard<std::mutex> guard(r.lock);
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto begin = [&](const char* name, char phase, uint32_t tid)
+	{
+		out << (first ? "" : ",\n") << "{\"name\":";
+		write_string(out, name);
+		out << ",\"ph\":\"" << phase << "\",\"pid\":1,\"tid\":" << tid;
+		first = false;
+	};
+
+	for (const auto& thread : r.threads)
+	{
+		if (const char* name = thread->name.load(std::memory_order_acquire))
+		{
+			begin("thread_name", 'M', thread->tid);
+			out << ",\"args\":{\"name\":";
+			write_string(out, name);
+			out << "}}";
+		}
+
+		const size_t count = thread->count.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; i++)
+		{
+			const Event& e = thread->chunks[i / chunk_size][i % chunk_size];
+			begin(e.name, e.phase, thread->tid);
+			out << ",\"ts\":";
+			write_time(out, e.ts);
+			switch (e.phase)
+			{
+			case 'X':
+				out << ",\"dur\":";
+				write_time(out, e.value);
+				break;
+			case 'i':
+				out << ",\"s\":\"t\"";
+				break;
+			default:
+				// flow ends bind to enclosing span instead of the next one
+				out << ",\"cat\":\"flow\",\"id\":" << e.value << (e.phase == 'f' ? ",\"bp\":\"e\"" : "");
+				break;
+			}
+			out << "}";
+		}
+	}
+	out << "\n]}\n";
+
+	return static_cast<bool>(out);
+}
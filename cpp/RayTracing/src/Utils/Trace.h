@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Timeline tracing, written as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev).
+// Compiled in only with RT_TRACING defined (cmake -DRT_TRACING=ON), otherwise every RT_TRACE_* macro expands to nothing.
+//
+// Every thread appends to its own buffer without locks, registry lock is taken once per thread on its first event.
+// Buffers outlive their threads, so pools can be torn down before `write_json`.
+
+namespace Utils
+{
+	namespace Trace
+	{
+#ifdef RT_TRACING
+		constexpr bool enabled = true;
+#else
+		constexpr bool enabled = false;
+#endif
+
+		/// <summary>
+		/// Nanoseconds since first use of the tracer
+		/// </summary>
+		uint64_t now();
+
+		/// <summary>
+		/// Name shown for calling thread, `name` has to outlive the tracer (string literal)
+		/// </summary>
+		void set_thread_name(const char* name);
+
+		/// <summary>
+		/// Span from `start` (see `now`) until now on calling thread
+		/// </summary>
+		void complete(const char* name, uint64_t start);
+
+		void instant(const char* name);
+
+		/// <summary>
+		/// Arrow from `flow_begin` to `flow_end` with the same `id`, possibly on another thread (eg. frame handoff).
+		/// Both ends attach to span enclosing them.
+		/// </summary>
+		void flow_begin(const char* name, uint64_t id);
+		void flow_end(const char* name, uint64_t id);
+
+		/// <summary>
+		/// Writes events of all threads recorded so far. Threads may keep tracing meanwhile, their newer events are skipped.
+		/// </summary>
+		bool write_json(const std::string& path);
+
+		/// <summary>
+		/// Records span from construction to destruction
+		/// </summary>
+		class Scope
+		{
+			const char* name;
+			uint64_t start;
+
+		public:
+			explicit Scope(const char* name) : name(name), start(now()) {}
+			~Scope() { complete(name, start); }
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		};
+	}
+}
+
+#define RT_TRACE_CONCAT_INNER(a, b) a##b
+#define RT_TRACE_CONCAT(a, b) RT_TRACE_CONCAT_INNER(a, b)
+
+#ifdef RT_TRACING
+#define RT_TRACE_SCOPE(name) const Utils::Trace::Scope RT_TRACE_CONCAT(rt_trace_scope_, __LINE__)(name)
+#define RT_TRACE_INSTANT(name) Utils::Trace::instant(name)
+#define RT_TRACE_FLOW_BEGIN(name, id) Utils::Trace::flow_begin(name, id)
+#define RT_TRACE_FLOW_END(name, id) Utils::Trace::flow_end(name, id)
+#define RT_TRACE_THREAD(name) Utils::Trace::set_thread_name(name)
+#else
+#define RT_TRACE_SCOPE(name) ((void)0)
+#define RT_TRACE_INSTANT(name) ((void)0)
+#define RT_TRACE_FLOW_BEGIN(name, id) ((void)0)
+#define RT_TRACE_FLOW_END(name, id) ((void)0)
+#define RT_TRACE_THREAD(name) ((void)0)
+#endif
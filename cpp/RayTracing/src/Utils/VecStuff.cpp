@@ -1,17 +1,30 @@
 #include "VecStuff.h"
+#include <cmath>
+#include <algorithm>
 
 
-glm::vec3 Utils::Vec3::rnd_unit_sphere(std::mt19937& gen)
+glm::vec3 Utils::Vec3::sphere_uniform(const glm::vec2& u)
 {
-	const std::uniform_real_distribution<float> rand(-1.0f, 1.0f);
+	const float z = 1.0f - 2.0f * u.x;
+	const float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+	const float phi = 6.28318531f * u.y;
+	return { r * std::cos(phi), r * std::sin(phi), z };
+}
 
-	for (size_t i = 0; i < 2; i++)
-	{
-		glm::vec3 vec(rand(gen), rand(gen), rand(gen));
-		if (glm::dot(vec, vec) < 1.0f)
-			return vec;
-	}
-	return glm::vec3(rand(gen) * 0.86, rand(gen) * 0.86, rand(gen) * 0.86);
+glm::vec3 Utils::Vec3::ball_uniform(const glm::vec2& u, float w)
+{
+	return sphere_uniform(u) * std::cbrt(w);
+}
+
+glm::vec3 Utils::Vec3::cosine_hemisphere(const glm::vec2& u, const glm::vec3& n)
+{
+	// normal plus uniform point on unit sphere is cosine distributed (Lambert), no tangent frame needed
+	const glm::vec3 dir = n + sphere_uniform(u);
+	const float length = glm::dot(dir, dir);
+	// sphere point opposite to normal
+	if (length < 1e-12f)
+		return n;
+	return dir / std::sqrt(length);
 }
 
 float Utils::Vec3::sqr_lenght(const glm::vec3& val) {
@@ -1,13 +1,29 @@
 #pragma once
 #include <glm.hpp>
-#include <random>
+#include "Random.h"
 
 namespace Utils
 {
 	namespace Vec3
 	{
-		glm::vec3 rnd_unit_sphere(std::mt19937& gen);
+		// Closed form warps of uniform [0, 1)^2 samples, they keep stratification of low discrepancy samples
+		// (rejection sampling would not) and take fixed number of dimensions.
+
+		/// <summary>
+		/// Uniform direction, `u.x` picks height, `u.y` angle around z
+		/// </summary>
+		glm::vec3 sphere_uniform(const glm::vec2& u);
+
+		/// <summary>
+		/// Uniform point inside unit ball, `w` picks distance from center
+		/// </summary>
+		glm::vec3 ball_uniform(const glm::vec2& u, float w);
+
+		/// <summary>
+		/// Cosine weighted direction around unit normal `n`, normalized
+		/// </summary>
+		glm::vec3 cosine_hemisphere(const glm::vec2& u, const glm::vec3& n);
 
 		float sqr_lenght(const glm::vec3& val);
 	}
-}
\ No newline at end of file
+}